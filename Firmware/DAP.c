@@ -45,7 +45,6 @@
 // Clock Macros
 
 #define MAX_SWJ_CLOCK(delay_cycles)	( CPU_CLOCK / 2 / (IO_PORT_WRITE_CYCLES + delay_cycles))
-#define CLOCK_DELAY(swj_clock)		((CPU_CLOCK / 2 / swj_clock) - IO_PORT_WRITE_CYCLES)
 
 
          DAP_Data_t DAP_Data;           // DAP Data
@@ -71,6 +70,10 @@ const char TargetDeviceVendor [] = TARGET_DEVICE_VENDOR;
 const char TargetDeviceName   [] = TARGET_DEVICE_NAME;
 #endif
 
+#if ((DAP_SWD != 0) || (DAP_JTAG != 0))
+static uint32_t SWJ_ClockActual(void);
+#endif
+
 
 // Get DAP Information
 //   id:      info identifier
@@ -79,6 +82,9 @@ const char TargetDeviceName   [] = TARGET_DEVICE_NAME;
 static uint8_t DAP_Info(uint8_t id, uint8_t *info)
 {
 	uint8_t length = 0;
+#if ((DAP_SWD != 0) || (DAP_JTAG != 0))
+	uint32_t clock;
+#endif
 
 	DEBUG("DAP_Info: %02X\n", id);
 
@@ -120,9 +126,29 @@ static uint8_t DAP_Info(uint8_t id, uint8_t *info)
 			break;
 		case DAP_ID_CAPABILITIES:
 			info[0] =	((DAP_SWD  != 0) ? (1 << 0) : 0) |
-						((DAP_JTAG != 0) ? (1 << 1) : 0);
+						((DAP_JTAG != 0) ? (1 << 1) : 0) |
+						((DAP_SWO  != 0) ? (1 << 2) : 0);
 			length = 1;
 			break;
+#if (DAP_SWO != 0)
+		case DAP_ID_SWO_BUFFER_SIZE:
+			info[0] = (uint8_t)(SWO_BUFFER_SIZE >>  0);
+			info[1] = (uint8_t)(SWO_BUFFER_SIZE >>  8);
+			info[2] = (uint8_t)(SWO_BUFFER_SIZE >> 16);
+			info[3] = (uint8_t)(SWO_BUFFER_SIZE >> 24);
+			length = 4;
+			break;
+#endif
+#if ((DAP_SWD != 0) || (DAP_JTAG != 0))
+		case DAP_ID_SWJ_CLOCK:
+			clock = SWJ_ClockActual();
+			info[0] = (uint8_t)(clock >>  0);
+			info[1] = (uint8_t)(clock >>  8);
+			info[2] = (uint8_t)(clock >> 16);
+			info[3] = (uint8_t)(clock >> 24);
+			length = 4;
+			break;
+#endif
 		case DAP_ID_PACKET_SIZE:
 			info[0] = (uint8_t)(DAP_PACKET_SIZE >> 0);
 			info[1] = (uint8_t)(DAP_PACKET_SIZE >> 8);
@@ -390,38 +416,97 @@ static uint32_t DAP_SWJ_Pins(uint8_t *request, uint8_t *response)
 #endif
 
 
-// Process SWJ Clock command and prepare response
-//   request:  pointer to request data
-//   response: pointer to response data
-//   return:   number of bytes in response
 #if ((DAP_SWD != 0) || (DAP_JTAG != 0))
-static uint32_t DAP_SWJ_Clock(uint8_t *request, uint8_t *response)
+#if (DAP_SWJ_CLOCK_CAL != 0)
+// Measure SWJ clock period of I/O Port clock generation
+//   delay:  clock delay (0 = fast clock)
+//   return: clock period in 1/16 CPU cycles
+static uint32_t SWJ_ClockMeasure(uint32_t delay)
 {
-	uint32_t clock;
-	uint32_t delay;
+	uint32_t ticks;
+	uint32_t n, t;
+
+	DAP_Data.clock_delay = delay;
+	ticks = 0xFFFFFFFF;
+	for (n = 2; n != 0; n--)
+	{	// Keep shortest run (interrupts only add cycles)
+		t = (delay == 0) ? SWJ_ClockMeasureFast() : SWJ_ClockMeasureSlow();
+		if (t < ticks) ticks = t;
+	}
+	return (ticks / (SWJ_CLOCK_CAL_CYCLES / 16));
+}
 
-	clock = (*(request + 0) <<  0) |
-			(*(request + 1) <<  8) |
-			(*(request + 2) << 16) |
-			(*(request + 3) << 24);
+// Calibrate SWJ clock generation against SysTick
+//   period(delay) = base + step * delay   [1/16 CPU cycles]
+static void SWJ_ClockCalibrate(void)
+{
+	uint32_t t1, t2;
+
+	t1 = SWJ_ClockMeasure(2);
+	t2 = SWJ_ClockMeasure(2 + 32);
+	DAP_Data.clock_cal.step = (t2 > t1) ? ((t2 - t1) / 32) : 1;
+	DAP_Data.clock_cal.base = t1 - 2 * DAP_Data.clock_cal.step;
+	DAP_Data.clock_cal.fast = SWJ_ClockMeasure(0);
+
+	DEBUG("SWJ_ClockCalibrate: %u %u %u\n",
+		DAP_Data.clock_cal.fast,
+		DAP_Data.clock_cal.base,
+		DAP_Data.clock_cal.step
+	);
+}
 
-	DEBUG("DAP_SWJ_Clock: %u\n", clock);
+#define SWJ_CLOCK_FAST()		(CPU_CLOCK * 16 / DAP_Data.clock_cal.fast)
+#define SWJ_CLOCK_SLOW(delay)	(CPU_CLOCK * 16 / (DAP_Data.clock_cal.base + DAP_Data.clock_cal.step * (delay)))
+#else
+#define SWJ_CLOCK_FAST()		MAX_SWJ_CLOCK(DELAY_FAST_CYCLES)
+#define SWJ_CLOCK_SLOW(delay)	MAX_SWJ_CLOCK(DELAY_SLOW_CYCLES * (delay))
+#endif
 
-	if (clock == 0)
-	{
-		*response = DAP_ERROR;
-		return (1);
-	}
+// Get actual SWJ clock frequency of current clock settings
+//   return: frequency in Hz
+static uint32_t SWJ_ClockActual(void)
+{
+#if (DAP_SWJ_DMA != 0)
+	if (DAP_Data.dma_clock)
+		return (DAP_Data.dma_clock_hz);
+#endif
+	if (DAP_Data.fast_clock)
+		return (SWJ_CLOCK_FAST());
+	return (SWJ_CLOCK_SLOW(DAP_Data.clock_delay));
+}
+
+// Set SWJ clock to the fastest achievable frequency not above the request
+//   clock:  requested frequency in Hz
+//   return: actual frequency in Hz
+static uint32_t SWJ_ClockSet(uint32_t clock)
+{
+	uint32_t delay;
 
-	if (clock >= MAX_SWJ_CLOCK(DELAY_FAST_CYCLES))
+	if (clock >= SWJ_CLOCK_FAST())
 	{
 		DAP_Data.fast_clock  = 1;
 		DAP_Data.clock_delay = 1;
 	}
 	else
 	{
-		DAP_Data.fast_clock  = 0;
+#if (DAP_SWJ_CLOCK_CAL != 0)
+		uint32_t period;
 
+		// Shortest delay with period >= requested period
+		period = (CPU_CLOCK * 16 + (clock - 1)) / clock;
+		if (period > DAP_Data.clock_cal.base + DAP_Data.clock_cal.step)
+		{
+			delay = (period - DAP_Data.clock_cal.base + (DAP_Data.clock_cal.step - 1)) / DAP_Data.clock_cal.step;
+		}
+		else
+		{
+			delay = 1;
+		}
+		while (SWJ_CLOCK_SLOW(delay) > clock)
+		{	// Integer rounding of calibrated frequency
+			delay++;
+		}
+#else
 		delay = (CPU_CLOCK / 2 + (clock - 1)) / clock;
 		if (delay > IO_PORT_WRITE_CYCLES)
 		{
@@ -432,10 +517,200 @@ static uint32_t DAP_SWJ_Clock(uint8_t *request, uint8_t *response)
 		{
 			delay  = 1;
 		}
-
+#endif
+		DAP_Data.fast_clock  = 0;
 		DAP_Data.clock_delay = delay;
 	}
 
+#if (DAP_SWJ_DMA != 0)
+	DAP_Data.dma_clock_hz = SWJ_DMA_Clock(clock);
+	DAP_Data.dma_clock    = (DAP_Data.dma_clock_hz != 0) ? 1 : 0;
+#endif
+#if (DAP_SWD != 0)
+	SWD_Select();
+#endif
+	return (SWJ_ClockActual());
+}
+#endif
+
+
+#if ((DAP_SWD != 0) && ((DAP_SWD_AUTO_CLOCK != 0) || (DAP_SWD_RECOVERY != 0)))
+// SWD line reset (51 clocks with SWDIO high) followed by 8 idle clocks
+static const uint8_t SWD_LineResetSequence[8] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x07, 0x00
+};
+
+static void SWD_LineReset(void)
+{
+	SWJ_Sequence(51 + 8, (uint8_t *)SWD_LineResetSequence);
+}
+#endif
+
+
+#if ((DAP_SWD != 0) && (DAP_SWD_AUTO_CLOCK != 0))
+// Change clock of SWD Auto Clock mode
+//   clock:  new clock frequency in Hz
+//   return: 1 = clock changed, 0 = clock not changed
+static uint32_t SWD_AutoClockSet(uint32_t clock)
+{
+	if (clock > DAP_Data.auto_clock.limit)
+		clock = DAP_Data.auto_clock.limit;
+	if (clock < SWD_AUTO_CLOCK_MIN)
+		clock = SWD_AUTO_CLOCK_MIN;
+	clock = SWJ_ClockSet(clock);
+	if (clock == DAP_Data.auto_clock.clock)
+		return (0);
+	DAP_Data.auto_clock.clock = clock;
+	DAP_Data.auto_clock.good  = 0;
+	return (1);
+}
+
+// SWD Transfer I/O with automatic clock tuning
+//   Parity and protocol errors lower the clock and the transfer is replayed,
+//   after SWD_AUTO_CLOCK_PROBE clean transfers the clock is raised again.
+//   An AP read with protocol error is not replayed: the target may have
+//   executed it (TAR auto increment), the error is returned at the lower clock.
+//   request: A[3:2] RnW APnDP
+//   data:    DATA[31:0]
+//   return:  ACK[2:0]
+uint8_t SWD_TransferAuto(uint8_t request, uint32_t *data)
+{
+	uint32_t clock;
+	uint32_t abort;
+	uint32_t n;
+	uint8_t  ack;
+
+	ack = DAP_Data.auto_clock.transfer(request, data);
+	if ((ack == DAP_TRANSFER_OK) || (ack == DAP_TRANSFER_WAIT) || (ack == DAP_TRANSFER_FAULT))
+	{
+		if ((DAP_Data.auto_clock.clock < DAP_Data.auto_clock.limit) &&
+			(++DAP_Data.auto_clock.good >= SWD_AUTO_CLOCK_PROBE))
+		{	// Probe next higher clock
+			DAP_Data.auto_clock.good = 0;
+			clock = DAP_Data.auto_clock.clock;
+			SWD_AutoClockSet(clock + (clock >> 2));
+		}
+		return (ack);
+	}
+
+	clock = DAP_Data.auto_clock.clock;
+	for (n = SWD_AUTO_CLOCK_STEPS; n != 0; n--)
+	{
+		if (!SWD_AutoClockSet(DAP_Data.auto_clock.clock - (DAP_Data.auto_clock.clock >> 2)))
+			break;
+		if (ack == DAP_TRANSFER_ERROR)
+		{	// Read parity error: AP read data is returned again by DP RESEND
+			if (request & DAP_TRANSFER_APnDP)
+				request = DP_RESEND | DAP_TRANSFER_RnW;
+		}
+		else
+		{	// Protocol error: line reset and IDCODE read
+			SWD_LineReset();
+			if (DAP_Data.auto_clock.transfer(DP_IDCODE | DAP_TRANSFER_RnW, NULL) != DAP_TRANSFER_OK)
+				continue;
+			if ((request & (DAP_TRANSFER_APnDP | DAP_TRANSFER_RnW)) == (DAP_TRANSFER_APnDP | DAP_TRANSFER_RnW))
+			{	// AP read is not replayed (link works at lower clock)
+				DAP_Data.auto_clock.downshift++;
+				return (ack);
+			}
+			if (request & DAP_TRANSFER_APnDP)
+			{	// AP write: clear sticky errors (as link recovery)
+				abort = 0x1E;	// STKCMPCLR | STKERRCLR | WDERRCLR | ORUNERRCLR
+				if (DAP_Data.auto_clock.transfer(DP_ABORT, &abort) != DAP_TRANSFER_OK)
+					continue;
+			}
+		}
+		ack = DAP_Data.auto_clock.transfer(request, data);
+		if ((ack == DAP_TRANSFER_OK) || (ack == DAP_TRANSFER_WAIT) || (ack == DAP_TRANSFER_FAULT))
+		{
+			DAP_Data.auto_clock.downshift++;
+			DEBUG("SWD_TransferAuto: %u\n", DAP_Data.auto_clock.clock);
+			return (ack);
+		}
+	}
+
+	// Errors are not caused by the clock (no target): restore clock
+	SWD_AutoClockSet(clock);
+	return (ack);
+}
+#endif
+
+
+#if ((DAP_SWD != 0) && (DAP_SWD_RECOVERY != 0))
+// SWD Transfer I/O with link recovery
+//   A protocol error (no valid ACK) is followed by line reset, IDCODE read,
+//   clear of sticky errors, restore of DP SELECT (DAP_Data.dp_select) and
+//   replay of the transfer.
+//   An AP read is not replayed: the target may have executed it (TAR auto
+//   increment), the error is returned with the link recovered.
+//   request: A[3:2] RnW APnDP
+//   data:    DATA[31:0]
+//   return:  ACK[2:0]
+uint8_t SWD_TransferRecover(uint8_t request, uint32_t *data)
+{
+	uint32_t abort;
+	uint32_t n;
+	uint8_t  ack;
+
+	ack = DAP_Data.recovery.transfer(request, data);
+	for (n = SWD_RECOVERY_RETRY; n != 0; n--)
+	{
+		if ((ack == DAP_TRANSFER_OK)   || (ack == DAP_TRANSFER_WAIT) ||
+			(ack == DAP_TRANSFER_FAULT) || (ack == DAP_TRANSFER_ERROR))
+		{
+			break;
+		}
+		SWD_LineReset();
+		if (DAP_Data.recovery.transfer(DP_IDCODE | DAP_TRANSFER_RnW, NULL) != DAP_TRANSFER_OK)
+			continue;
+		abort = 0x1E;	// STKCMPCLR | STKERRCLR | WDERRCLR | ORUNERRCLR
+		if (DAP_Data.recovery.transfer(DP_ABORT, &abort) != DAP_TRANSFER_OK)
+			continue;
+		if (DAP_Data.dp_select_valid &&
+			(DAP_Data.recovery.transfer(DP_SELECT, &DAP_Data.dp_select) != DAP_TRANSFER_OK))
+			continue;
+		DAP_Data.recovery.count++;
+		DEBUG("SWD_TransferRecover: %d\n", DAP_Data.recovery.count);
+		if ((request & (DAP_TRANSFER_APnDP | DAP_TRANSFER_RnW)) == (DAP_TRANSFER_APnDP | DAP_TRANSFER_RnW))
+			break;		// AP read is not replayed (link recovered)
+		ack = DAP_Data.recovery.transfer(request, data);
+	}
+	return (ack);
+}
+#endif
+
+
+// Process SWJ Clock command and prepare response
+//   request:  pointer to request data
+//   response: pointer to response data
+//   return:   number of bytes in response
+#if ((DAP_SWD != 0) || (DAP_JTAG != 0))
+static uint32_t DAP_SWJ_Clock(uint8_t *request, uint8_t *response)
+{
+	uint32_t clock;
+
+	clock = (*(request + 0) <<  0) |
+			(*(request + 1) <<  8) |
+			(*(request + 2) << 16) |
+			(*(request + 3) << 24);
+
+	DEBUG("DAP_SWJ_Clock: %u", clock);
+
+	if (clock == 0)
+	{
+		DEBUG("\n");
+		*response = DAP_ERROR;
+		return (1);
+	}
+
+	clock = SWJ_ClockSet(clock);
+#if ((DAP_SWD != 0) && (DAP_SWD_AUTO_CLOCK != 0))
+	DAP_Data.auto_clock.limit = clock;
+	DAP_Data.auto_clock.clock = clock;
+	DAP_Data.auto_clock.good  = 0;
+#endif
+	DEBUG(" -> %u\n", clock);
+
 	*response = DAP_OK;
 	return (1);
 }
@@ -482,6 +757,7 @@ static uint32_t DAP_SWD_Configure(uint8_t *request, uint8_t *response)
 		DAP_Data.swd_conf.turnaround,
 		DAP_Data.swd_conf.data_phase
 	);
+	SWD_Select();
   
 	*response = DAP_OK;
 	return (1);
@@ -696,6 +972,9 @@ static uint32_t DAP_TransferConfigure(uint8_t *request, uint8_t *response)
 		DAP_Data.transfer.retry_count,
 		DAP_Data.transfer.match_retry
 	);
+#if (DAP_SWD != 0)
+	SWD_Select();
+#endif
 	*response = DAP_OK;
 	return (1);
 }
@@ -706,7 +985,7 @@ static uint32_t DAP_TransferConfigure(uint8_t *request, uint8_t *response)
 //   response: pointer to response data
 //   return:   number of bytes in response
 #if (DAP_SWD != 0)
-static uint32_t DAP_SWD_Transfer(uint8_t *request, uint8_t *response)
+RAMFUNC static uint32_t DAP_SWD_Transfer(uint8_t *request, uint8_t *response)
 {
 	uint8_t  request_count;
 	uint8_t  request_value;
@@ -886,6 +1165,10 @@ static uint32_t DAP_SWD_Transfer(uint8_t *request, uint8_t *response)
 				
 				if (response_value != DAP_TRANSFER_OK)
 					break;
+#if (DAP_SWD_SELECT != 0)
+				if ((request_value & 0x0F) == DP_SELECT)
+					SWD_SelectWritten(data);
+#endif
 				check_write = 1;
 			}
 		}
@@ -925,7 +1208,6 @@ static uint32_t DAP_SWD_Transfer(uint8_t *request, uint8_t *response)
 end:
 	*(response_head + 0) = (uint8_t)response_count;
 	*(response_head + 1) = (uint8_t)response_value;
-
 	return (response - response_head);
 }
 #endif
@@ -1217,6 +1499,10 @@ static uint32_t DAP_SWD_TransferBlock(uint8_t *request, uint8_t *response)
 				response_value = SWD_Transfer(request_value, &data);
 			} while ((response_value == DAP_TRANSFER_WAIT) && retry-- && !DAP_TransferAbort);
 			if (response_value != DAP_TRANSFER_OK) goto end;
+#if (DAP_SWD_SELECT != 0)
+			if ((request_value & 0x0F) == DP_SELECT)
+				SWD_SelectWritten(data);
+#endif
 			response_count++;
 		}
 		// Check last write
@@ -1342,17 +1628,147 @@ end:
 #endif
 
 
+// Process SWO Transport command and prepare response
+//   request:  pointer to request data
+//             transport: 0 = none, 1 = read with DAP_SWO_Data command
+//   response: pointer to response data
+//   return:   number of bytes in response
+#if (DAP_SWO != 0)
+static uint32_t DAP_SWO_Transport(uint8_t *request, uint8_t *response)
+{
+	DEBUG("DAP_SWO_Transport: %d\n", *request);
+	*response = (*request <= 1) ? DAP_OK : DAP_ERROR;
+	return (1);
+}
+#endif
+
+
+// Process SWO Mode command and prepare response
+//   request:  pointer to request data
+//             mode: DAP_SWO_OFF, DAP_SWO_UART (Manchester is not supported)
+//   response: pointer to response data
+//   return:   number of bytes in response
+#if (DAP_SWO != 0)
+static uint32_t DAP_SWO_Mode(uint8_t *request, uint8_t *response)
+{
+	uint32_t ok;
+
+	DEBUG("DAP_SWO_Mode: %d\n", *request);
+	switch (*request)
+	{
+		case DAP_SWO_OFF:
+		case DAP_SWO_UART:
+			ok = SWO_UART_Mode(*request);
+			break;
+		default:
+			SWO_UART_Mode(0);
+			ok = 0;
+	}
+	*response = ok ? DAP_OK : DAP_ERROR;
+	return (1);
+}
+#endif
+
+
+// Process SWO Baudrate command and prepare response
+//   request:  pointer to request data
+//             baudrate in Hz (4)
+//   response: pointer to response data
+//   return:   number of bytes in response
+//             (actual baudrate in Hz (4), 0 = not supported)
+#if (DAP_SWO != 0)
+static uint32_t DAP_SWO_Baudrate(uint8_t *request, uint8_t *response)
+{
+	uint32_t baudrate;
+
+	baudrate = (*(request + 0) <<  0) |
+			   (*(request + 1) <<  8) |
+			   (*(request + 2) << 16) |
+			   (*(request + 3) << 24);
+	baudrate = SWO_UART_Baudrate(baudrate);
+	DEBUG("DAP_SWO_Baudrate: %u\n", baudrate);
+
+	*(response + 0) = (uint8_t)(baudrate >>  0);
+	*(response + 1) = (uint8_t)(baudrate >>  8);
+	*(response + 2) = (uint8_t)(baudrate >> 16);
+	*(response + 3) = (uint8_t)(baudrate >> 24);
+	return (4);
+}
+#endif
+
+
+// Process SWO Control command and prepare response
+//   request:  pointer to request data
+//             control: 0 = stop capture, 1 = start capture
+//   response: pointer to response data
+//   return:   number of bytes in response
+#if (DAP_SWO != 0)
+static uint32_t DAP_SWO_Control(uint8_t *request, uint8_t *response)
+{
+	DEBUG("DAP_SWO_Control: %d\n", *request);
+	*response = SWO_UART_Control(*request & 1) ? DAP_OK : DAP_ERROR;
+	return (1);
+}
+#endif
+
+
+// Process SWO Status command and prepare response
+//   response: pointer to response data
+//   return:   number of bytes in response
+//             (trace status, trace count (4))
+#if (DAP_SWO != 0)
+static uint32_t DAP_SWO_Status(uint8_t *response)
+{
+	uint32_t count;
+
+	*(response + 0) = (uint8_t)SWO_UART_Status();
+	count = SWO_UART_Count();
+	*(response + 1) = (uint8_t)(count >>  0);
+	*(response + 2) = (uint8_t)(count >>  8);
+	*(response + 3) = (uint8_t)(count >> 16);
+	*(response + 4) = (uint8_t)(count >> 24);
+	return (5);
+}
+#endif
+
+
+// Process SWO Data command and prepare response
+//   request:  pointer to request data
+//             maximum trace count (2)
+//   response: pointer to response data
+//   return:   number of bytes in response
+//             (trace status, trace count (2), trace data)
+#if (DAP_SWO != 0)
+static uint32_t DAP_SWO_Data(uint8_t *request, uint8_t *response)
+{
+	uint32_t count;
+
+	count = *(request + 0) | (*(request + 1) << 8);
+	if (count > (DAP_PACKET_SIZE - 4))
+		count = DAP_PACKET_SIZE - 4;
+
+	*(response + 0) = (uint8_t)SWO_UART_Status();
+	count = SWO_UART_Read(response + 3, count);
+	*(response + 1) = (uint8_t)(count >> 0);
+	*(response + 2) = (uint8_t)(count >> 8);
+	return (3 + count);
+}
+#endif
+
+
 // Process DAP Vendor command and prepare response
 // Default function (can be overridden)
 //   request:  pointer to request data
 //   response: pointer to response data
 //   return:   number of bytes in response
+#if (DAP_VENDOR_COMMANDS == 0)
 __weak uint32_t DAP_ProcessVendorCommand(uint8_t *request, uint8_t *response)
 {
 	DEBUG("DAP_ProcessVendorCommand:\n");
 	*response = ID_DAP_Invalid;
 	return (1);
 }
+#endif
 
 
 // Process DAP command and prepare response
@@ -1438,6 +1854,27 @@ uint32_t DAP_ProcessCommand(uint8_t *request, uint8_t *response)
 			return (2);
 #endif
 
+#if (DAP_SWO != 0)
+		case ID_DAP_SWO_Transport:
+			num = DAP_SWO_Transport(request, response);
+			break;
+		case ID_DAP_SWO_Mode:
+			num = DAP_SWO_Mode(request, response);
+			break;
+		case ID_DAP_SWO_Baudrate:
+			num = DAP_SWO_Baudrate(request, response);
+			break;
+		case ID_DAP_SWO_Control:
+			num = DAP_SWO_Control(request, response);
+			break;
+		case ID_DAP_SWO_Status:
+			num = DAP_SWO_Status(response);
+			break;
+		case ID_DAP_SWO_Data:
+			num = DAP_SWO_Data(request, response);
+			break;
+#endif
+
 		case ID_DAP_TransferConfigure:
 			num = DAP_TransferConfigure(request, response);
 			break;
@@ -1516,7 +1953,6 @@ void DAP_Setup(void)
 	// Default settings (only non-zero values)
 	//	DAP_Data.debug_port  = 0;
 	//	DAP_Data.fast_clock  = 0;
-	DAP_Data.clock_delay = CLOCK_DELAY(DAP_DEFAULT_SWJ_CLOCK);
 	//	DAP_Data.transfer.idle_cycles = 0;
 	DAP_Data.transfer.retry_count = 100;
 	//	DAP_Data.transfer.match_retry = 0;
@@ -1527,6 +1963,20 @@ void DAP_Setup(void)
 #endif
 #if (DAP_JTAG != 0)
 	//	DAP_Data.jtag_dev.count = 0;
+#endif
+#if (DAP_SWJ_DMA != 0)
+	SWJ_DMA_Setup();
+#endif
+#if ((DAP_SWD != 0) || (DAP_JTAG != 0))
+#if (DAP_SWJ_CLOCK_CAL != 0)
+	SWJ_ClockCalibrate();	// I/O pins are not yet enabled by DAP_SETUP
+#endif
+#if ((DAP_SWD != 0) && (DAP_SWD_AUTO_CLOCK != 0))
+	DAP_Data.auto_clock.limit = SWJ_ClockSet(DAP_DEFAULT_SWJ_CLOCK);
+	DAP_Data.auto_clock.clock = DAP_Data.auto_clock.limit;
+#else
+	SWJ_ClockSet(DAP_DEFAULT_SWJ_CLOCK);
+#endif
 #endif
 
 	DAP_SETUP();  // Device specific setup
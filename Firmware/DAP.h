@@ -42,6 +42,12 @@
 #define ID_DAP_JTAG_Sequence		0x14
 #define ID_DAP_JTAG_Configure		0x15
 #define ID_DAP_JTAG_IDCODE			0x16
+#define ID_DAP_SWO_Transport		0x17
+#define ID_DAP_SWO_Mode				0x18
+#define ID_DAP_SWO_Baudrate			0x19
+#define ID_DAP_SWO_Control			0x1A
+#define ID_DAP_SWO_Status			0x1B
+#define ID_DAP_SWO_Data				0x1C
 
 // DAP Vendor Command IDs
 #define ID_DAP_Vendor0				0x80
@@ -90,7 +96,9 @@
 #define DAP_ID_FW_VER				4
 #define DAP_ID_DEVICE_VENDOR		5
 #define DAP_ID_DEVICE_NAME			6
+#define DAP_ID_SWJ_CLOCK			0xE0		// Actual SWJ clock in Hz (not in CMSIS-DAP specification)
 #define DAP_ID_CAPABILITIES			0xF0
+#define DAP_ID_SWO_BUFFER_SIZE		0xFD
 #define DAP_ID_PACKET_COUNT			0xFE
 #define DAP_ID_PACKET_SIZE			0xFF
 
@@ -127,6 +135,16 @@
 #define DAP_TRANSFER_ERROR			(1 << 3)
 #define DAP_TRANSFER_MISMATCH		(1 << 4)
 
+// DAP SWO Trace Mode
+#define DAP_SWO_OFF					0
+#define DAP_SWO_UART				1
+#define DAP_SWO_MANCHESTER			2
+
+// DAP SWO Trace Status
+#define DAP_SWO_CAPTURE_ACTIVE		(1 << 0)
+#define DAP_SWO_STREAM_ERROR		(1 << 6)
+#define DAP_SWO_BUFFER_OVERRUN		(1 << 7)
+
 
 // Debug Port Register Addresses
 #define DP_IDCODE					0x00	// IDCODE Register (SW Read only)
@@ -149,6 +167,58 @@
 #define JTAG_SEQUENCE_TMS			0x40	// TMS value
 #define JTAG_SEQUENCE_TDO			0x80	// TDO capture
 
+// Optional Debug Unit features (enabled in DAP_config.h)
+#ifndef DAP_SWJ_DMA
+#define DAP_SWJ_DMA					0		// SWD/JTAG waveform generated by DMA
+#endif
+#ifndef DAP_SWJ_CLOCK_CAL
+#define DAP_SWJ_CLOCK_CAL			0		// SWJ clock calibrated against SysTick
+#endif
+#ifndef DAP_SWD_AUTO_CLOCK
+#define DAP_SWD_AUTO_CLOCK			0		// SWD clock tuned by transfer errors
+#endif
+#ifndef DAP_SWD_RECOVERY
+#define DAP_SWD_RECOVERY			0		// SWD link recovery after protocol errors
+#endif
+#ifndef DAP_SWD_GANG
+#define DAP_SWD_GANG				0		// SWD gang mode for several targets
+#endif
+#ifndef DAP_SWD_MONITOR
+#define DAP_SWD_MONITOR				0		// Target run state monitor
+#endif
+#if ((DAP_SWD_MONITOR != 0) || (DAP_SWD_RECOVERY != 0))
+#define DAP_SWD_SELECT				1		// DP SELECT value kept for probe side accesses and recovery
+#else
+#define DAP_SWD_SELECT				0
+#endif
+#ifndef DAP_SWD_CONDITION
+#define DAP_SWD_CONDITION			0		// Conditional breakpoints (with run state monitor)
+#endif
+#ifndef DAP_SWD_TRACEPOINT
+#define DAP_SWD_TRACEPOINT			0		// Tracepoints (with run state monitor)
+#endif
+#ifndef DAP_SWD_PROFILE
+#define DAP_SWD_PROFILE				0		// PC sampling profiler (DWT PCSR)
+#endif
+#ifndef DAP_SWD_SAMPLE
+#define DAP_SWD_SAMPLE				0		// Live variable sampler
+#endif
+#ifndef DAP_SWD_RTT
+#define DAP_SWD_RTT					0		// RTT bridge to virtual COM port
+#endif
+#ifndef DAP_SWD_SEMIHOST
+#define DAP_SWD_SEMIHOST			0		// Semihosting console output to virtual COM port
+#endif
+#ifndef DAP_SWO
+#define DAP_SWO						0		// SWO trace capture in UART mode
+#endif
+#ifndef DAP_VENDOR_COMMANDS
+#define DAP_VENDOR_COMMANDS			0		// Vendor commands provided by DAP_vendor.c
+#endif
+#ifndef RAMFUNC
+#define RAMFUNC								// Placement of SWD hot path functions
+#endif
+
 #include <stddef.h>
 #include <stdint.h>
 
@@ -157,6 +227,17 @@ typedef struct
 {
 	uint8_t	 debug_port;			// Debug Port
 	uint8_t	 fast_clock;			// Fast Clock Flag
+#if (DAP_SWJ_DMA != 0)
+	uint8_t	 dma_clock;				// DMA Clock Flag
+	uint32_t	dma_clock_hz;		// DMA Clock Frequency
+#endif
+#if (DAP_SWJ_CLOCK_CAL != 0)
+	struct {						// Clock Calibration (period in 1/16 CPU cycles)
+		uint32_t	fast;			// Fast clock period
+		uint32_t	base;			// Slow clock period without delay
+		uint32_t	step;			// Slow clock period per delay count
+	} clock_cal;
+#endif
 	uint32_t	clock_delay;		// Clock Delay
 	struct {						// Transfer Configuration
 		uint8_t	idle_cycles;		// Idle cycles after transfer
@@ -170,6 +251,28 @@ typedef struct
 		uint8_t		turnaround;		// Turnaround period
 		uint8_t		data_phase;		// Always generate Data Phase
 	} swd_conf;
+	uint8_t (*swd_transfer)(uint8_t request, uint32_t *data);	// SWD Transfer function (see SWD_Select)
+#if (DAP_SWD_SELECT != 0)
+	uint8_t		dp_select_valid;	// DP SELECT value is known
+	uint32_t	dp_select;			// Last DP SELECT value written (see SWD_SelectWritten)
+#endif
+#if (DAP_SWD_AUTO_CLOCK != 0)
+	struct {						// SWD Auto Clock
+		uint8_t		enable;			// Auto Clock enabled
+		uint16_t	good;			// Clean transfers since last clock change
+		uint16_t	downshift;		// Number of recovered clock downshifts
+		uint32_t	clock;			// Actual clock frequency
+		uint32_t	limit;			// Clock frequency set by DAP_SWJ_Clock
+		uint8_t	  (*transfer)(uint8_t request, uint32_t *data);	// SWD Transfer function at actual clock
+	} auto_clock;
+#endif
+#if (DAP_SWD_RECOVERY != 0)
+	struct {						// SWD Link Recovery
+		uint8_t		enable;			// Recovery enabled
+		uint16_t	count;			// Number of link recoveries
+		uint8_t	  (*transfer)(uint8_t request, uint32_t *data);	// SWD Transfer function without recovery
+	} recovery;
+#endif
 #endif
 
 #if (DAP_JTAG != 0)
@@ -189,6 +292,15 @@ typedef struct
 extern		  DAP_Data_t DAP_Data;			// DAP Data
 extern volatile uint8_t	DAP_TransferAbort;	// Transfer Abort Flag
 
+#if ((DAP_SWD != 0) && (DAP_SWD_SELECT != 0))
+// Keep DP SELECT (write only register) after every successful SELECT write
+static __inline void SWD_SelectWritten (uint32_t select)
+{
+	DAP_Data.dp_select       = select;
+	DAP_Data.dp_select_valid = 1;
+}
+#endif
+
 
 // Functions
 extern void		SWJ_Sequence	(uint32_t count, uint8_t *data);
@@ -197,17 +309,54 @@ extern void		JTAG_IR			(uint32_t ir);
 extern uint32_t	JTAG_ReadIDCode	(void);
 extern void		JTAG_WriteAbort	(uint32_t data);
 extern uint8_t	JTAG_Transfer	(uint8_t request, uint32_t *data);
-extern uint8_t	SWD_Transfer	(uint8_t request, uint32_t *data);
+extern void		SWD_Select		(void);
+#if ((DAP_SWD != 0) && (DAP_SWD_AUTO_CLOCK != 0))
+extern uint8_t	SWD_TransferAuto(uint8_t request, uint32_t *data);
+#endif
+#if ((DAP_SWD != 0) && (DAP_SWD_RECOVERY != 0))
+extern uint8_t	SWD_TransferRecover(uint8_t request, uint32_t *data);
+#endif
+#if (DAP_SWJ_CLOCK_CAL != 0)
+extern uint32_t	SWJ_ClockMeasureFast(void);
+extern uint32_t	SWJ_ClockMeasureSlow(void);
+#endif
+#if (DAP_SWD != 0)
+#define SWD_Transfer(request, data)	DAP_Data.swd_transfer(request, data)
+#endif
+
+#if (DAP_SWJ_DMA != 0)
+extern void		SWJ_DMA_Setup	(void);
+extern uint32_t	SWJ_DMA_Clock	(uint32_t clock);
+extern uint8_t	SWD_TransferDMA	(uint8_t request, uint32_t *data);
+extern void		JTAG_SequenceDMA(uint32_t info,  uint8_t *tdi, uint8_t *tdo);
+extern void		JTAG_IR_DMA		(uint32_t ir);
+extern uint8_t	JTAG_TransferDMA(uint32_t request, uint32_t *data);
+#endif
+
+#if (DAP_SWO != 0)
+extern uint32_t	SWO_UART_Mode	(uint32_t enable);
+extern uint32_t	SWO_UART_Baudrate(uint32_t baudrate);
+extern uint32_t	SWO_UART_Control(uint32_t active);
+extern uint32_t	SWO_UART_Status	(void);
+extern uint32_t	SWO_UART_Count	(void);
+extern uint32_t	SWO_UART_Read	(uint8_t *data, uint32_t count);
+#endif
 
 extern void		Delayms			(uint32_t delay);
 
 extern uint32_t	DAP_ProcessVendorCommand(uint8_t *request, uint8_t *response);
+#if (DAP_VENDOR_COMMANDS != 0)
+extern uint32_t	DAP_ProcessVendorIdle	(uint8_t *report);
+extern uint32_t	DAP_ProcessVendorBusy	(void);
+#endif
 
 extern uint32_t	DAP_ProcessCommand(uint8_t *request, uint8_t *response);
 extern void		DAP_Setup(void);
 
 // Configurable delay for clock generation
+#ifndef DELAY_SLOW_CYCLES
 #define DELAY_SLOW_CYCLES		3	// Number of cycles for one iteration
+#endif
 static __forceinline void PIN_DELAY_SLOW (uint32_t delay)
 {
 	volatile int32_t count;
@@ -76,6 +76,13 @@ void JTAG_Sequence (uint32_t info, uint8_t *tdi, uint8_t *tdo) {
   uint32_t bit;
   uint32_t n, k;
 
+#if (DAP_SWJ_DMA != 0)
+  if (DAP_Data.dma_clock) {
+    JTAG_SequenceDMA(info, tdi, tdo);
+    return;
+  }
+#endif
+
   n = info & JTAG_SEQUENCE_TCK;
   if (n == 0) n = 64;
 
@@ -334,6 +341,12 @@ void JTAG_WriteAbort (uint32_t data) {
 //   ir:     IR value
 //   return: none
 void JTAG_IR (uint32_t ir) {
+#if (DAP_SWJ_DMA != 0)
+  if (DAP_Data.dma_clock) {
+    JTAG_IR_DMA(ir);
+    return;
+  }
+#endif
   if (DAP_Data.fast_clock) {
     JTAG_IR_Fast(ir);
   } else {
@@ -348,6 +361,10 @@ void JTAG_IR (uint32_t ir) {
 //   return:  ACK[2:0]
 uint8_t  JTAG_Transfer(uint8_t request, uint32_t *data)
 {
+#if (DAP_SWJ_DMA != 0)
+	if (DAP_Data.dma_clock)
+		return JTAG_TransferDMA(request, data);
+#endif
 	if (DAP_Data.fast_clock)
 	{
 		return JTAG_TransferFast(request, data);
@@ -37,6 +37,7 @@ static volatile uint32_t USB_ResponseOut;       // Response Buffer Out Index
 
 static          uint8_t  USB_Request [DAP_PACKET_COUNT][DAP_PACKET_SIZE];  // Request  Buffer
 static          uint8_t  USB_Response[DAP_PACKET_COUNT][DAP_PACKET_SIZE];  // Response Buffer
+static          uint16_t USB_ResponseLen[DAP_PACKET_COUNT];                // Response Length
 
 
 // USB HID Callback: when system initializes
@@ -52,6 +53,7 @@ void usbd_hid_init (void) {
 
 // USB HID Callback: when data needs to be prepared for the host
 int usbd_hid_get_report (U8 rtype, U8 rid, U8 *buf, U8 req) {
+  uint32_t n;
 
   switch (rtype) {
     case HID_REPORT_INPUT:
@@ -61,7 +63,10 @@ int usbd_hid_get_report (U8 rtype, U8 rid, U8 *buf, U8 req) {
           break;
         case USBD_HID_REQ_EP_INT:
           if ((USB_ResponseOut != USB_ResponseIn) || USB_ResponseFlag) {
-            memcpy(buf, USB_Response[USB_ResponseOut], DAP_PACKET_SIZE);
+            // Copy response, report is padded with zeros to its fixed size
+            n = USB_ResponseLen[USB_ResponseOut];
+            memcpy(buf, USB_Response[USB_ResponseOut], n);
+            memset(buf + n, 0, DAP_PACKET_SIZE - n);
             USB_ResponseOut++;
             if (USB_ResponseOut == DAP_PACKET_COUNT) {
               USB_ResponseOut = 0;
@@ -112,13 +117,18 @@ void usbd_hid_set_report (U8 rtype, U8 rid, U8 *buf, int len, U8 req) {
 
 // Process USB HID Data
 void usbd_hid_process (void) {
+  uint32_t len;
   uint32_t n;
 
   // Process pending requests
   if ((USB_RequestOut != USB_RequestIn) || USB_RequestFlag) {
 
     // Process DAP Command and prepare response
-    DAP_ProcessCommand(USB_Request[USB_RequestOut], USB_Response[USB_ResponseIn]);
+    len = DAP_ProcessCommand(USB_Request[USB_RequestOut], USB_Response[USB_ResponseIn]);
+    if (len > DAP_PACKET_SIZE) {
+      len = DAP_PACKET_SIZE;
+    }
+    USB_ResponseLen[USB_ResponseIn] = len;
 
     // Update request index and flag
     n = USB_RequestOut + 1;
@@ -133,6 +143,7 @@ void usbd_hid_process (void) {
     if (USB_ResponseIdle) {
       // Request that data is send back to host
       USB_ResponseIdle = 0;
+      memset(&USB_Response[USB_ResponseIn][len], 0, DAP_PACKET_SIZE - len);
       usbd_hid_get_report_trigger(0, USB_Response[USB_ResponseIn], DAP_PACKET_SIZE);
     } else {      
       // Update response index and flag
@@ -1,5 +1,3 @@
-#define TIMEOUT_DELAY	200000
-
 #include <stdio.h>
 
 #include <RTL.h>
@@ -14,11 +12,31 @@
 
 #include "usbd_user_cdc_acm.h"
 
+// Scheduler tick: wakes the main loop from sleep and times the LEDs
+#define SCHED_TIM				TIM4
+#define SCHED_TIM_IRQn			TIM4_IRQn
+#define SCHED_TIM_IRQHandler	TIM4_IRQHandler
+#define SCHED_TICK				1000		// Tick period in us
+#define SCHED_SLEEP				1			// Sleep (WFE) when no task has work
+
+#define LED_IDLE_PERIOD			2000		// Connected LED flash period while idle (ms)
+#define LED_IDLE_FLASH			20			// Connected LED flash time (ms)
+#define LED_NO_APP_PERIOD		500			// Connected LED toggle period without user application (ms)
+
+#define CDC_CHUNK				64			// Bytes moved per Virtual COM port transfer
+
 uint8_t usbd_hid_process(void);
+void usbd_hid_idle(void);
+uint32_t usbd_hid_pending(void);
 void CheckUserApplication(void);
 
 void LedConnectedOut(uint16_t bit);
 void LedRunningOut(uint16_t bit);
+#if (USBD_CDC_ACM_ENABLE == 1)
+int32_t CdcWrite(const uint8_t *data, int32_t size);
+int32_t CdcRead(uint8_t *data, int32_t size);
+void CdcClaim(uint16_t claim);
+#endif
 
 void Delay_ms(uint32_t delay);
 
@@ -32,15 +50,33 @@ UserAppDescriptor_t * pUserAppDescriptor = NULL;
 const CoreDescriptor_t CoreDescriptor = {
 	&LedConnectedOut,
 	&LedRunningOut,
+#if (USBD_CDC_ACM_ENABLE == 1)
+	&CdcWrite,
+	&CdcRead,
+	&CdcClaim,
+#else
+	NULL,
+	NULL,
+	NULL,
+#endif
+	&usbd_hid_pending,
 };
 
 #if (USBD_CDC_ACM_ENABLE == 1)
-	int32_t usb_rx_ch;
-	int32_t usb_tx_ch;
+	uint8_t cdc_claimed;	// Virtual COM port used by user application
 #endif
 
+// Run-to-completion task: returns 1 while it has more work
+typedef struct {
+	uint32_t	(*run)(void);	// Task function
+	uint32_t	budget;			// Time for repeated calls per pass in us (0 = one call)
+} TASK;
+
+static volatile uint32_t sched_ms;	// Tick count in ms
+static uint32_t sched_cycles_us;	// CPU cycles per us
+static uint32_t dap_active_ms;		// Time of last DAP request
+
 uint32_t led_count;
-uint32_t led_timeout;
 
 /**
   * @brief	LED functions
@@ -78,6 +114,194 @@ void LedRunningOut(uint16_t bit)
 	else			LedRunningOff();
 }
 
+#if (USBD_CDC_ACM_ENABLE == 1)
+/**
+  * @brief	Virtual COM port functions for user application
+  *
+  */
+int32_t CdcWrite(const uint8_t *data, int32_t size)
+{
+	return USBD_CDC_ACM_DataSend(data, size);
+}
+int32_t CdcRead(uint8_t *data, int32_t size)
+{
+	return USBD_CDC_ACM_DataRead(data, size);
+}
+void CdcClaim(uint16_t claim)
+{
+	cdc_claimed = (claim & 1);
+	UART_RxBridge(!cdc_claimed);
+}
+#endif
+
+/**
+  * @brief	Tasks in priority order
+  *
+  */
+// DAP request processing
+static uint32_t Task_Dap(void)
+{
+	if (!usbd_hid_process())
+		return (0);
+	dap_active_ms = sched_ms;
+	return (1);
+}
+
+#if (USBD_CDC_ACM_ENABLE == 1)
+static uint8_t  cdc_out[CDC_CHUNK];		// USB -> UART, not yet written
+static uint32_t cdc_out_len;
+static uint32_t cdc_out_pos;
+
+// Virtual COM port bridge USB -> UART (one chunk per call)
+//   UART -> USB is done by the receive interrupts, retried here when the
+//   CDC send buffer was full.
+static uint32_t Task_Cdc(void)
+{
+	uint32_t work = 0;
+	int32_t  n;
+
+	NotifyOnStatusChange();
+	if (cdc_claimed)
+		return (0);
+
+	// USB -> UART
+	if (cdc_out_pos == cdc_out_len)
+	{
+		cdc_out_pos = 0;
+		cdc_out_len = USBD_CDC_ACM_DataRead(cdc_out, CDC_CHUNK);
+	}
+	if (cdc_out_pos < cdc_out_len)
+	{
+		n = UART_WriteData(&cdc_out[cdc_out_pos], cdc_out_len - cdc_out_pos);
+		cdc_out_pos += n;
+		work |= (n != 0);
+	}
+
+	// UART -> USB
+	UART_RxFlush();
+	return (work);
+}
+#endif
+
+// Background monitors of user application (SWO, RTT, target monitor)
+//   Reports work while the user application has idle work pending, so the
+//   scheduler does not sleep until the next tick (sampler, RTT rate).
+static uint32_t Task_Monitor(void)
+{
+	if (pUserAppDescriptor == NULL)
+		return (0);
+	usbd_hid_idle();
+	if (pUserAppDescriptor->UserBusy == NULL)
+		return (0);
+	return (pUserAppDescriptor->UserBusy() != 0);
+}
+
+// Connected LED: flashes while idle, off while DAP requests are processed
+//   The LED is only switched on flash start and end, so the host can still
+//   set it with DAP_HostStatus.
+static uint32_t Task_Led(void)
+{
+	static uint8_t led_flash;
+	uint32_t time;
+	uint8_t  flash;
+
+	if (pUserAppDescriptor == NULL)
+	{	// No user application
+		if ((sched_ms - led_count) >= LED_NO_APP_PERIOD)
+		{
+			led_count = sched_ms;
+			LedConnectedToggle();
+		}
+		return (0);
+	}
+	time  = sched_ms - dap_active_ms;
+	flash = (time >= LED_IDLE_PERIOD) && ((time % LED_IDLE_PERIOD) < LED_IDLE_FLASH);
+	if (flash != led_flash)
+	{
+		led_flash = flash;
+		LedConnectedOut(flash);
+	}
+	return (0);
+}
+
+static const TASK Tasks[] = {
+	{	Task_Dap,		500	},		// Highest priority: runs before each other task
+#if (USBD_CDC_ACM_ENABLE == 1)
+	{	Task_Cdc,		100	},
+#endif
+	{	Task_Monitor,	0	},
+	{	Task_Led,		0	},
+};
+#define TASK_COUNT	(sizeof(Tasks) / sizeof(Tasks[0]))
+
+/**
+  * @brief	Scheduler
+  *
+  */
+void SCHED_TIM_IRQHandler(void)
+{
+	SCHED_TIM->SR = ~TIM_SR_UIF;
+	sched_ms += SCHED_TICK / 1000;
+}
+
+// Start cycle counter (task budgets) and tick timer
+static void Sched_Init(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+	sched_cycles_us = CPU_CLOCK / 1000000;
+
+	// Timer clock is CPU_CLOCK (APB1 prescaler is 2)
+	RCC->APB1ENR |= RCC_APB1ENR_TIM4EN;
+	SCHED_TIM->PSC  = sched_cycles_us - 1;
+	SCHED_TIM->ARR  = SCHED_TICK - 1;
+	SCHED_TIM->EGR  = TIM_EGR_UG;
+	SCHED_TIM->SR   = 0;
+	SCHED_TIM->DIER = TIM_DIER_UIE;
+	SCHED_TIM->CR1  = TIM_CR1_CEN;
+	NVIC_SetPriority(SCHED_TIM_IRQn, (1 << __NVIC_PRIO_BITS) - 1);
+	NVIC_EnableIRQ(SCHED_TIM_IRQn);
+}
+
+// Run task until it has no more work or its budget is used
+//   A lower priority task also stops when a DAP request is waiting.
+//	return:	1 = task did work
+static uint32_t Sched_Run(const TASK *task)
+{
+	uint32_t start;
+
+	start = DWT->CYCCNT;
+	if (!task->run())
+		return (0);
+	while (((DWT->CYCCNT - start) < (task->budget * sched_cycles_us)) &&
+		((task == &Tasks[0]) || !usbd_hid_pending()) && task->run())
+	{ }
+	return (1);
+}
+
+// Run all tasks once, DAP processing before each lower priority task.
+// A DAP request waits for the running call of a lower priority task: one
+// COM port chunk (USB -> UART), or one vendor idle step (PCSR sample, sampler
+// block reads, RTT or semihosting chunk, monitor poll).
+// Sleep if no task had work: WFE returns at once if an interrupt was taken
+// during the pass (event register set on exception entry), otherwise it
+// waits for the next interrupt (USB, USART, tick).
+static void Sched_Pass(void)
+{
+	uint32_t busy = 0;
+	uint32_t n;
+
+	for (n = 1; n < TASK_COUNT; n++)
+	{
+		busy |= Sched_Run(&Tasks[0]);
+		busy |= Sched_Run(&Tasks[n]);
+	}
+#if (SCHED_SLEEP != 0)
+	if (!busy)
+		__WFE();
+#endif
+}
+
 /**
   * @brief	Main
   *
@@ -115,66 +339,10 @@ int main(void)
 	LedConnectedOff();
 	Delay_ms(100);				// Wait for 100ms
 
-	led_count = 0;
-	led_timeout = TIMEOUT_DELAY;
-	usb_rx_ch = -1;
-	usb_tx_ch = -1;
-
+	Sched_Init();
 	while (1)
 	{
-		if (pUserAppDescriptor == NULL)
-		{	// No user application
-			if (led_count++ == 1000000)
-			{
-				led_count = 0;
-				LedConnectedToggle();
-			}
-			usbd_hid_process();
-		}
-		else if (!usbd_hid_process())
-		{
-			// No packet processing
-			if (led_timeout == 1000)
-			{
-				LedConnectedOn();
-			}
-			else if (led_timeout == 0)
-			{
-				LedConnectedOff();
-				led_timeout = TIMEOUT_DELAY;
-			}
-			led_timeout--;
-			
-		}
-		else
-		{
-			led_timeout = TIMEOUT_DELAY;
-		}
-
-#if (USBD_CDC_ACM_ENABLE == 1)
-
-		NotifyOnStatusChange();
-
-		// USB -> UART
-		if (usb_rx_ch == -1)
-			usb_rx_ch = USBD_CDC_ACM_GetChar();
-
-		if (usb_rx_ch != -1)
-		{
-			if (UART_PutChar (usb_rx_ch) == usb_rx_ch)
-				usb_rx_ch = -1;
-		}
-
-		// UART -> USB
-		if (usb_tx_ch == -1)
-			usb_tx_ch = UART_GetChar();
-
-		if (usb_tx_ch != -1)
-		{
-			if (USBD_CDC_ACM_PutChar(usb_tx_ch) == usb_tx_ch)
-				usb_tx_ch = -1;
-		}
-#endif
+		Sched_Pass();
 	}
 }
 
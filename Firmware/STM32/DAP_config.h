@@ -31,6 +31,10 @@ typedef const struct
 {
 	void	(* LedConnected)	(uint16_t);
 	void	(* LedRunning)		(uint16_t);
+	int32_t	(* CdcWrite)		(const uint8_t *, int32_t);	// Virtual COM port (NULL if not available)
+	int32_t	(* CdcRead)			(uint8_t *, int32_t);
+	void	(* CdcClaim)		(uint16_t);					// 1 = used by user application, 0 = UART bridge
+	uint32_t	(* RequestPending)	(void);					// 1 = USB request waiting (stop idle work)
 } CoreDescriptor_t;
 
 extern const CoreDescriptor_t * pCoreDescriptor;
@@ -40,6 +44,8 @@ typedef const struct
 	void		(* UserInit)	(CoreDescriptor_t * core);
 	uint32_t	(* UserProcess)	(uint8_t *, uint8_t *);
 	void		(* UserAbort)	(void);
+	uint32_t	(* UserIdle)	(uint8_t *);
+	uint32_t	(* UserBusy)	(void);							// 1 = idle work pending (no sleep)
 } UserAppDescriptor_t;
 
 #if !defined ( BOARD_V1      )	\
@@ -104,6 +110,14 @@ Provides definitions about:
 /// requrired.
 #define IO_PORT_WRITE_CYCLES	2               ///< I/O Cycles: 2=default, 1=Cortex-M0+ fast I/0
 
+/// SWD_TransferFast, SWJ_ClockMeasureFast and DAP_SWD_Transfer can be executed from SRAM
+/// (section RAMCODE, region RW_USER_CODE in CMSIS_DAP-C8.sct/CMSIS_DAP-CB.sct) to avoid
+/// Flash wait states. Slow (delay loop), turnaround > 1 and JTAG engines stay in Flash.
+/// Disabled until SWCLK rate and transfer throughput from SRAM are measured against Flash
+/// and the RW_USER_CODE fit is checked in the linker map; enable with:
+///   #define RAMFUNC __attribute__((section("RAMCODE")))
+#define RAMFUNC												///< Placement of SWD hot path (empty = Flash).
+
 /// Indicate that Serial Wire Debug (SWD) communication mode is available at the Debug Access Port.
 /// This information is returned by the command \ref DAP_Info as part of <b>Capabilities</b>.
 #define DAP_SWD                 1               ///< SWD Mode:  1 = available, 0 = not available
@@ -131,6 +145,115 @@ Provides definitions about:
 /// The command \ref DAP_SWJ_Clock can be used to overwrite this default setting.
 #define DAP_DEFAULT_SWJ_CLOCK   1000000         ///< Default SWD/JTAG clock frequency in Hz.
 
+/// Calibrate the I/O Port SWD/JTAG clock generation against SysTick in \ref DAP_Setup.
+/// The command \ref DAP_SWJ_Clock then selects the closest achievable frequency and
+/// returns the actual frequency in its response.
+#define DAP_SWJ_CLOCK_CAL		1				///< Clock calibration: 1 = enabled, 0 = disabled.
+#define SWJ_CLOCK_CAL_CYCLES	256				///< Number of clock periods per measurement.
+
+/// Automatic SWD clock tuning (enabled with vendor command \ref ID_DAP_AutoClock).
+/// A parity or protocol error lowers the SWD clock by 25% (line reset and IDCODE read
+/// after protocol errors) and replays the transfer. After \ref SWD_AUTO_CLOCK_PROBE clean
+/// transfers the clock is raised again up to the frequency set by \ref DAP_SWJ_Clock.
+#define DAP_SWD_AUTO_CLOCK		1				///< SWD Auto Clock: 1 = available, 0 = not available.
+#define SWD_AUTO_CLOCK_PROBE	1024			///< Clean transfers before next higher clock is probed.
+#define SWD_AUTO_CLOCK_STEPS	4				///< Maximum clock downshifts for one transfer.
+#define SWD_AUTO_CLOCK_MIN		100000			///< Lowest SWD clock frequency in Hz.
+
+/// SWD link recovery (enabled with vendor command \ref ID_DAP_Recovery).
+/// A protocol error is followed by line reset, IDCODE read, clear of sticky errors and
+/// restore of DP SELECT, then the transfer is replayed and \ref DAP_Transfer continues.
+/// The number of recoveries is reported by the \ref ID_DAP_Recovery status query.
+#define DAP_SWD_RECOVERY		1				///< SWD Recovery: 1 = available, 0 = not available.
+#define SWD_RECOVERY_RETRY		3				///< Maximum recoveries for one transfer.
+
+/// Target run state monitor (enabled with vendor command \ref ID_DAP_Monitor).
+/// While no USB request is pending DHCSR is read every monitor period and a change of
+/// the run state (halt, run, lockup, reset) is sent to the host as unsolicited report.
+#define DAP_SWD_MONITOR			1				///< Run State Monitor: 1 = available, 0 = not available.
+#define MONITOR_PERIOD			5				///< Default monitor period in ms.
+
+/// Conditional breakpoints (set with vendor command \ref ID_DAP_Condition).
+/// A breakpoint halt found by the run state monitor is evaluated by the probe: if the
+/// condition is false the breakpoint is stepped over and the target is resumed.
+#define DAP_SWD_CONDITION		1				///< Conditional Breakpoints: 1 = available, 0 = not available.
+#define CONDITION_COUNT			4				///< Number of breakpoint conditions.
+
+/// Tracepoints (set with vendor command \ref ID_DAP_Tracepoint, read with \ref ID_DAP_TraceRead).
+/// A breakpoint halt on a tracepoint captures core registers and memory ranges into the
+/// trace buffer, then the breakpoint is stepped over and the target is resumed.
+#define DAP_SWD_TRACEPOINT		1				///< Tracepoints: 1 = available, 0 = not available.
+#define TRACEPOINT_COUNT		4				///< Number of tracepoints.
+#define TRACE_RANGES			2				///< Memory ranges per tracepoint.
+#define TRACE_WORDS				8				///< Maximum words per memory range.
+#define TRACE_BUFFER_SIZE		512				///< Trace buffer size in bytes.
+
+/// PC sampling profiler (controlled with vendor commands \ref ID_DAP_Profile and
+/// \ref ID_DAP_ProfileRead). While no USB request is pending, DWT PCSR is sampled
+/// in bursts and accumulated into a histogram of 2^shift byte address bins.
+#define DAP_SWD_PROFILE			1				///< PC Profiler: 1 = available, 0 = not available.
+#define PROFILE_BINS			256				///< Number of histogram bins.
+#define PROFILE_BURST			64				///< Maximum PCSR samples per idle call (stops at next USB request).
+
+/// Live variable sampler (controlled with vendor commands \ref ID_DAP_Sample and
+/// \ref ID_DAP_SampleRead). Registered items are read at a fixed rate while no USB
+/// request is pending; items less than \ref SAMPLE_GAP words apart share one block read.
+#define DAP_SWD_SAMPLE			1				///< Sampler: 1 = available, 0 = not available.
+#define SAMPLE_ITEMS			16				///< Maximum number of items.
+#define SAMPLE_WORDS			32				///< Maximum words of block reads per sample.
+#define SAMPLE_GAP				4				///< Maximum gap in words between coalesced items.
+#define SAMPLE_BUFFER_SIZE		512				///< Sample buffer size in bytes.
+
+/// RTT bridge (controlled with vendor command \ref ID_DAP_Rtt). The RTT up-buffer of the
+/// target is forwarded to the virtual COM port and received data to the down-buffer.
+/// The control block is set by address or found by a scan of a target memory range.
+#define DAP_SWD_RTT				1				///< RTT Bridge: 1 = available, 0 = not available.
+#define RTT_PERIOD				1000			///< Buffer poll period in us.
+#define RTT_CHUNK				64				///< Maximum bytes per buffer access.
+#define RTT_SCAN_WORDS			64				///< Words per scan step.
+
+/// Semihosting fast path (enabled with vendor command \ref ID_DAP_Semihost).
+/// SYS_WRITEC, SYS_WRITE0 and SYS_WRITE to stdout/stderr found by the run state monitor
+/// are queued for the virtual COM port (sent from the idle loop, one chunk at a time)
+/// and the target is resumed when the text is sent; other operations are reported to
+/// the host as halt.
+#define DAP_SWD_SEMIHOST		1				///< Semihosting: 1 = available, 0 = not available.
+#define SEMIHOST_CHUNK			64				///< Bytes per target memory read (output queue size).
+#define SEMIHOST_STRING			1024			///< Maximum SYS_WRITE0 string length.
+#define SEMIHOST_TIMEOUT		100				///< Output is discarded if the COM port is not read for this time in ms.
+
+/// SWO trace capture in UART (NRZ) mode (commands \ref ID_DAP_SWO_Mode .. \ref ID_DAP_SWO_Data).
+/// The target SWO pin must be connected to the SWO USART RX pin (see SWO_RX_PIN).
+/// Trace data is stored by circular DMA, the buffer is read with \ref ID_DAP_SWO_Data.
+/// The DMA half/complete interrupt advances the write position, so overruns are
+/// detected without polling. The host must read the buffer in time: 512 bytes hold
+/// about 2.5 ms of trace at 2 Mbaud (an overrun drops the buffered data).
+#if !defined ( BOARD_STM32RF )
+	#define DAP_SWO				1				///< SWO UART: 1 = available, 0 = not available.
+	#define SWO_BUFFER_SIZE		512				///< Trace buffer size in bytes (2^n).
+#endif
+
+/// Vendor commands are implemented in DAP_vendor.c (included by UserApp.c).
+#define DAP_VENDOR_COMMANDS		1				///< Vendor commands: 1 = DAP_vendor.c, 0 = none.
+
+/// SWD gang mode (vendor commands \ref ID_DAP_GangSetup, \ref ID_DAP_GangSequence and
+/// \ref ID_DAP_GangTransfer). Targets share SWCLK, every target has its own SWDIO pin.
+/// In gang mode the JTAG TDI and TDO pins are used as SWDIO of the 2nd and 3rd target.
+/// All SWDIO pins must be located on the SWCLK/TCK GPIO port.
+#if (DAP_JTAG != 0)
+	#define DAP_SWD_GANG		1				///< SWD Gang: 1 = available, 0 = not available.
+	#define GANG_COUNT			3				///< Number of gang targets.
+	#define GANG_SWDIO_PINS		{ PIN_SWDIO_TMS_PIN, PIN_TDI_PIN, PIN_TDO_PIN }
+#endif
+
+/// Generate the SWD/JTAG waveform with TIM3 and DMA1 instead of I/O Port write operations.
+/// Clock frequencies up to CPU_CLOCK/2/\ref SWJ_DMA_MIN_TICKS are generated by DMA with a
+/// fixed bit period; faster clock requests use the I/O Port functions.
+/// SWCLK/TCK, SWDIO/TMS, TDI and TDO must be located on the same GPIO port.
+/// Disabled by default: the DMA waveform has not been validated with a scope capture yet.
+#define DAP_SWJ_DMA				0				///< SWJ DMA: 1 = enabled, 0 = disabled.
+#define SWJ_DMA_MIN_TICKS		18				///< Minimum timer ticks per half SWCLK/TCK period.
+
 /// Maximum Package Size for Command and Response data.
 /// This configuration settings is used to optimized the communication performance with the
 /// debugger and depends on the USB peripheral. Change setting to 1024 for High-Speed USB.
@@ -168,7 +291,7 @@ typedef enum Pin_e {
 	PD = 0x30, PD0 = 0x30, PD1, PD2,
 } Pin_t;
 
-// USART Port and I/O Pins
+// USART Port and I/O Pins (virtual COM port: circular DMA receive, DMA transmit)
 
 #if   defined ( BOARD_V1 )	\
  ||   defined ( BOARD_V2 )	\
@@ -184,7 +307,17 @@ typedef enum Pin_e {
 	#define USART_RX_PIN		GPIO_Pin_10
 	#define USART_IRQn			USART1_IRQn
 	#define USART_IRQHandler	USART1_IRQHandler
-	#define USART_BUFFER_SIZE	(256)	/*	Size of Receive and Transmit buffers MUST BE 2^n */
+	#define USART_BUFFER_SIZE	(256)	/*	Size of Transmit buffer MUST BE 2^n */
+	#define USART_RX_BUFFER_SIZE	(256)	/*	Size of Receive buffer (circular DMA) MUST BE 2^n, 256 B: 0.85 ms at 3 Mbaud */
+
+	#define USART_DMA_RX			DMA1_Channel5		/* USART1_RX */
+	#define USART_DMA_RX_IRQn		DMA1_Channel5_IRQn
+	#define USART_DMA_RX_IRQHandler	DMA1_Channel5_IRQHandler
+	#define USART_DMA_RX_CLEAR		DMA_IFCR_CGIF5
+	#define USART_DMA_TX			DMA1_Channel4		/* USART1_TX */
+	#define USART_DMA_TX_IRQn		DMA1_Channel4_IRQn
+	#define USART_DMA_TX_IRQHandler	DMA1_Channel4_IRQHandler
+	#define USART_DMA_TX_CLEAR		DMA_IFCR_CGIF4
 
 #elif defined ( STLINK_V20 )	\
   ||  defined ( STLINK_V21 )
@@ -198,7 +331,17 @@ typedef enum Pin_e {
 	#define USART_RX_PIN		GPIO_Pin_3
 	#define USART_IRQn			USART2_IRQn
 	#define USART_IRQHandler	USART2_IRQHandler
-	#define USART_BUFFER_SIZE	(256)	/*	Size of Receive and Transmit buffers MUST BE 2^n */
+	#define USART_BUFFER_SIZE	(256)	/*	Size of Transmit buffer MUST BE 2^n */
+	#define USART_RX_BUFFER_SIZE	(256)	/*	Size of Receive buffer (circular DMA) MUST BE 2^n, 256 B: 0.85 ms at 3 Mbaud */
+
+	#define USART_DMA_RX			DMA1_Channel6		/* USART2_RX */
+	#define USART_DMA_RX_IRQn		DMA1_Channel6_IRQn
+	#define USART_DMA_RX_IRQHandler	DMA1_Channel6_IRQHandler
+	#define USART_DMA_RX_CLEAR		DMA_IFCR_CGIF6
+	#define USART_DMA_TX			DMA1_Channel7		/* USART2_TX */
+	#define USART_DMA_TX_IRQn		DMA1_Channel7_IRQn
+	#define USART_DMA_TX_IRQHandler	DMA1_Channel7_IRQHandler
+	#define USART_DMA_TX_CLEAR		DMA_IFCR_CGIF7
 
 #else
 
@@ -206,6 +349,44 @@ typedef enum Pin_e {
 
 #endif
 
+// SWO USART Port and I/O Pins (RX only, DMA in circular mode)
+
+#if   defined ( BOARD_V1 )	\
+ ||   defined ( BOARD_V2 )
+
+	// SWO input on PA3 (USART2 RX), USART1 is used by the virtual COM port
+	#define SWO_USART_CLOCK(state)	RCC_APB1PeriphClockCmd(RCC_APB1Periph_USART2, state)
+	#define SWO_GPIO_CLOCK(state)	RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOA, state)
+	#define SWO_USART_PORT		USART2
+	#define SWO_USART_PCLK		(CPU_CLOCK / 2)		/* APB1 */
+	#define SWO_GPIO			GPIOA
+	#define SWO_RX_PIN			GPIO_Pin_3
+	#define SWO_DMA				DMA1_Channel6		/* USART2_RX */
+	#define SWO_DMA_HT			DMA_ISR_HTIF6
+	#define SWO_DMA_TC			DMA_ISR_TCIF6
+	#define SWO_DMA_CLEAR		DMA_IFCR_CGIF6
+	#define SWO_DMA_IRQn		DMA1_Channel6_IRQn
+	#define SWO_DMA_IRQHandler	DMA1_Channel6_IRQHandler
+
+#elif defined ( STLINK_V20 )	\
+  ||  defined ( STLINK_V21 )
+
+	// SWO input on PA10 (USART1 RX), USART2 is used by the virtual COM port
+	#define SWO_USART_CLOCK(state)	RCC_APB2PeriphClockCmd(RCC_APB2Periph_USART1, state)
+	#define SWO_GPIO_CLOCK(state)	RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOA, state)
+	#define SWO_USART_PORT		USART1
+	#define SWO_USART_PCLK		(CPU_CLOCK)			/* APB2 */
+	#define SWO_GPIO			GPIOA
+	#define SWO_RX_PIN			GPIO_Pin_10
+	#define SWO_DMA				DMA1_Channel5		/* USART1_RX */
+	#define SWO_DMA_HT			DMA_ISR_HTIF5
+	#define SWO_DMA_TC			DMA_ISR_TCIF5
+	#define SWO_DMA_CLEAR		DMA_IFCR_CGIF5
+	#define SWO_DMA_IRQn		DMA1_Channel5_IRQn
+	#define SWO_DMA_IRQHandler	DMA1_Channel5_IRQHandler
+
+#endif
+
 // USB Connect Pull-Up
 
 #if   defined ( BOARD_V1 )	\
@@ -259,11 +440,11 @@ typedef enum Pin_e {
 
 	// TDO/SWO Pin (input)
 	#define PIN_TDO_PORT            GPIOA
-	#define PIN_TDO					5
+	#define PIN_TDO_PIN				5
 
 	// TDI Pin (output)
 	#define PIN_TDI_PORT			GPIOA
-	#define PIN_TDI					7
+	#define PIN_TDI_PIN				7
 
 	// nRESET Pin
 	#define PIN_nRESET_PORT         GPIOA
@@ -281,11 +462,11 @@ typedef enum Pin_e {
 
 	// TDO/SWO Pin (input)
 	#define PIN_TDO_PORT            GPIOA
-	#define PIN_TDO					6
+	#define PIN_TDO_PIN				6
 
 	// TDI Pin (output)
 	#define PIN_TDI_PORT			GPIOA
-	#define PIN_TDI					7
+	#define PIN_TDI_PIN				7
 
 	// nRESET Pin
 	#define PIN_nRESET_PORT         GPIOB
@@ -304,7 +485,7 @@ typedef enum Pin_e {
 
 	// TDO/SWO Pin (input)
 	#define PIN_TDO_PORT            GPIOA
-	#define PIN_TDO					6
+	#define PIN_TDO_PIN				6
 
 	// nRESET Pin
 	#define PIN_nRESET_PORT         GPIOB
@@ -322,7 +503,7 @@ typedef enum Pin_e {
 
 	// TDI Pin (output)
 	#define PIN_TDI_PORT			GPIOA
-	#define PIN_TDI					8
+	#define PIN_TDI_PIN				8
 
 	// nRESET Pin
 	#define PIN_nRESET_PORT			GPIOB
@@ -393,6 +574,12 @@ typedef enum Pin_e {
 #define PIN_nRESET				PIN_MASK(PIN_nRESET_PIN)
 #define PIN_SWDIO_TMS			PIN_MASK(PIN_SWDIO_TMS_PIN)
 #define PIN_SWCLK_TCK			PIN_MASK(PIN_SWCLK_TCK_PIN)
+#ifdef PIN_TDI_PIN
+	#define PIN_TDI				PIN_MASK(PIN_TDI_PIN)
+#endif
+#ifdef PIN_TDO_PIN
+	#define PIN_TDO				PIN_MASK(PIN_TDO_PIN)
+#endif
 
 #if (PIN_nRESET_PIN >= 8)
 	#define PIN_nRESET_LOW()							\
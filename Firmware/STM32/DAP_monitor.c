@@ -0,0 +1,737 @@
+/******************************************************************************
+ * @file	DAP_monitor.c
+ * @brief	CMSIS-DAP target run state monitor (STM32)
+ *
+ * While no USB request is pending, DHCSR of the target is read once per
+ * monitor period (timed by the probe DWT cycle counter). A change of the run
+ * state (halt, run, lockup) or a target reset is reported to the host with an
+ * unsolicited report, so the debugger does not have to poll DHCSR.
+ * The MEM-AP state of the debugger (DP SELECT, CSW, TAR) is restored after
+ * every access. Sticky errors caused by a failed probe side access are
+ * cleared, sticky errors pending for the debugger are kept.
+ ******************************************************************************/
+
+#include "DAP_config.h"
+#include "..\DAP.h"
+
+#if ((DAP_SWD != 0) && (DAP_SWD_MONITOR != 0))
+
+// DHCSR bits of the run state
+#define MONITOR_STATE		(S_HALT | S_LOCKUP)
+
+// Maximum DHCSR reads for S_REGRDY and single step
+#define MONITOR_REG_RETRY	16
+
+static struct {
+	uint8_t		enable;			// Monitor enabled
+	uint8_t		valid;			// DHCSR value is valid
+	uint16_t	events;			// Number of reported events
+	uint32_t	period;			// Monitor period in CPU cycles
+	uint32_t	time;			// Time of last DHCSR read (DWT CYCCNT)
+	uint32_t	dhcsr;			// Last DHCSR value
+} Monitor;
+
+
+// Enable or disable run state monitor
+//	enable:	1 = enable, 0 = disable
+//	period:	monitor period in ms (0 = default)
+//	return:	none
+static void Monitor_Setup(uint32_t enable, uint32_t period)
+{
+	if (period == 0)
+		period = MONITOR_PERIOD;
+
+	// Probe DWT cycle counter as time base
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+
+	Monitor.enable = enable;
+	Monitor.valid  = 0;
+	Monitor.events = 0;
+	Monitor.period = period * (CPU_CLOCK / 1000);
+	Monitor.time   = DWT->CYCCNT - Monitor.period;
+}
+
+// Saved MEM-AP state of the debugger
+static uint32_t Monitor_SELECT;
+static uint32_t Monitor_STICKY;		// CTRL/STAT sticky flags
+static uint32_t Monitor_CSW;
+static uint32_t Monitor_TAR;
+
+// USB request waiting: probe side accesses stop at the next step
+//	return:	1 = request pending
+static __inline uint32_t Monitor_Preempt(void)
+{
+	return ((pCoreDescriptor->RequestPending != NULL) && pCoreDescriptor->RequestPending());
+}
+
+// Start probe side MEM-AP accesses: save SELECT, sticky flags, CSW and TAR
+// of the debugger
+//	return:	ACK[2:0]
+static uint8_t Monitor_Begin(void)
+{
+	uint8_t ack;
+
+	Monitor_SELECT = DAP_Data.dp_select;
+	Monitor_STICKY = STICKY_FLAGS;
+	ack = DP_Write(DP_SELECT, 0);
+	if (ack != DAP_TRANSFER_OK)
+		return (ack);
+	ack = DP_Read(DP_CTRL_STAT, &Monitor_STICKY);
+	if (ack != DAP_TRANSFER_OK)
+		return (ack);
+	Monitor_STICKY &= STICKY_FLAGS;
+	if (Monitor_STICKY)
+	{	// Errors pending for the debugger: MEM-AP is not accessible
+		return (DAP_TRANSFER_FAULT);
+	}
+	ack = AP_Read(AP_CSW, &Monitor_CSW);
+	if (ack != DAP_TRANSFER_OK)
+		return (ack);
+	ack = AP_Read(AP_TAR, &Monitor_TAR);
+	if (ack != DAP_TRANSFER_OK)
+		return (ack);
+	return (AP_Write(AP_CSW, CSW_VALUE));
+}
+
+// End probe side MEM-AP accesses: restore CSW, TAR and DP SELECT
+//	ack:	ACK[2:0] of probe side accesses
+//	return:	ACK[2:0]
+static uint8_t Monitor_End(uint8_t ack)
+{
+	uint32_t stat;
+	uint32_t abort;
+
+	if (ack == DAP_TRANSFER_OK)
+	{
+		ack = AP_Write(AP_CSW, Monitor_CSW);
+		if (ack == DAP_TRANSFER_OK)
+			ack = AP_Write(AP_TAR, Monitor_TAR);
+	}
+	if ((ack != DAP_TRANSFER_OK) && (Monitor_STICKY == 0))
+	{	// Clear only the sticky errors set by the failed access
+		if ((DP_Write(DP_SELECT, 0) == DAP_TRANSFER_OK) &&
+			(DP_Read(DP_CTRL_STAT, &stat) == DAP_TRANSFER_OK))
+		{
+			abort = 0;
+			if (stat & STICKYORUN)	abort |= ORUNERRCLR;
+			if (stat & WDATAERR)	abort |= WDERRCLR;
+			if (stat & STICKYERR)	abort |= STKERRCLR;
+			if (stat & STICKYCMP)	abort |= STKCMPCLR;
+			if (abort)
+				DP_Write(DP_ABORT, abort);
+		}
+	}
+	DP_Write(DP_SELECT, Monitor_SELECT);
+	return (ack);
+}
+
+// Read core register of halted target
+//	reg:	register number (DCRSR REGSEL)
+//	data:	pointer to value
+//	return:	ACK[2:0]
+static uint8_t Monitor_ReadReg(uint32_t reg, uint32_t *data)
+{
+	uint32_t dhcsr;
+	uint32_t n;
+	uint8_t  ack;
+
+	ack = MEM_AP_WriteWord(DBG_CRSR, reg);
+	for (n = 0; (ack == DAP_TRANSFER_OK) && (n < MONITOR_REG_RETRY); n++)
+	{
+		ack = MEM_AP_ReadWord(DBG_HCSR, &dhcsr);
+		if ((ack == DAP_TRANSFER_OK) && (dhcsr & S_REGRDY))
+			return (MEM_AP_ReadWord(DBG_CRDR, data));
+	}
+	return ((ack == DAP_TRANSFER_OK) ? DAP_TRANSFER_ERROR : ack);
+}
+
+// Write core register of halted target
+//	reg:	register number (DCRSR REGSEL)
+//	data:	value
+//	return:	ACK[2:0]
+static uint8_t Monitor_WriteReg(uint32_t reg, uint32_t data)
+{
+	uint32_t dhcsr;
+	uint32_t n;
+	uint8_t  ack;
+
+	ack = MEM_AP_WriteWord(DBG_CRDR, data);
+	if (ack == DAP_TRANSFER_OK)
+		ack = MEM_AP_WriteWord(DBG_CRSR, reg | DCRSR_REGWnR);
+	for (n = 0; (ack == DAP_TRANSFER_OK) && (n < MONITOR_REG_RETRY); n++)
+	{
+		ack = MEM_AP_ReadWord(DBG_HCSR, &dhcsr);
+		if ((ack == DAP_TRANSFER_OK) && (dhcsr & S_REGRDY))
+			return (DAP_TRANSFER_OK);
+	}
+	return ((ack == DAP_TRANSFER_OK) ? DAP_TRANSFER_ERROR : ack);
+}
+
+// Resume halted target
+//	step:	1 = step one instruction with interrupts masked before, 0 = run
+//	return:	ACK[2:0]
+static uint8_t Monitor_Resume(uint32_t step)
+{
+	uint32_t dhcsr;
+	uint32_t n;
+	uint8_t  ack;
+
+	if (step)
+	{
+		ack = MEM_AP_WriteWord(DBG_HCSR, DBGKEY | C_DEBUGEN | C_HALT | C_MASKINTS);
+		if (ack != DAP_TRANSFER_OK)
+			return (ack);
+		ack = MEM_AP_WriteWord(DBG_HCSR, DBGKEY | C_DEBUGEN | C_MASKINTS | C_STEP);
+		for (n = 0; (ack == DAP_TRANSFER_OK) && (n < MONITOR_REG_RETRY); n++)
+		{
+			ack = MEM_AP_ReadWord(DBG_HCSR, &dhcsr);
+			if ((ack == DAP_TRANSFER_OK) && (dhcsr & S_HALT))
+				break;
+		}
+		if (ack != DAP_TRANSFER_OK)
+			return (ack);
+		ack = MEM_AP_WriteWord(DBG_HCSR, DBGKEY | C_DEBUGEN | C_HALT);
+		if (ack != DAP_TRANSFER_OK)
+			return (ack);
+	}
+	return (MEM_AP_WriteWord(DBG_HCSR, DBGKEY | C_DEBUGEN));
+}
+
+// Step over FPB breakpoint and resume halted target
+//	comp:	FPB comparator of the breakpoint
+//	return:	ACK[2:0]
+static uint8_t Monitor_StepOver(uint32_t comp)
+{
+	uint32_t data;
+	uint8_t  ack;
+
+	ack = MEM_AP_ReadWord(FP_COMP(comp), &data);
+	if (ack == DAP_TRANSFER_OK)
+		ack = MEM_AP_WriteWord(FP_COMP(comp), data & ~FP_COMP_ENABLE);
+	if (ack == DAP_TRANSFER_OK)
+		ack = Monitor_Resume(1);
+	if (ack == DAP_TRANSFER_OK)
+		ack = MEM_AP_WriteWord(FP_COMP(comp), data);
+	if (ack == DAP_TRANSFER_OK)
+		ack = MEM_AP_WriteWord(DBG_DFSR, DFSR_BKPT | DFSR_HALTED);
+	if (ack == DAP_TRANSFER_OK)
+		ack = Monitor_Resume(0);
+	return (ack);
+}
+
+// Read target memory word and restore MEM-AP state of the debugger
+//	addr:	word aligned address
+//	data:	pointer to value
+//	return:	ACK[2:0]
+static uint8_t Monitor_ReadWord(uint32_t addr, uint32_t *data)
+{
+	uint8_t ack;
+
+	ack = Monitor_Begin();
+	if (ack == DAP_TRANSFER_OK)
+		ack = MEM_AP_ReadWord(addr, data);
+	return (Monitor_End(ack));
+}
+
+#if (DAP_SWD_CONDITION != 0)
+
+// Condition operators
+#define COND_OFF			0		// Condition not used
+#define COND_EQ				1		// (operand & mask) == value
+#define COND_NE				2		// (operand & mask) != value
+#define COND_LT				3		// (operand & mask) <  value (unsigned)
+#define COND_LE				4		// (operand & mask) <= value (unsigned)
+#define COND_GT				5		// (operand & mask) >  value (unsigned)
+#define COND_GE				6		// (operand & mask) >= value (unsigned)
+#define COND_OP_MASK		0x0F
+#define COND_REGISTER		0x80	// Operand is core register (else memory word)
+
+// Breakpoint conditions
+static struct {
+	uint8_t		op;				// Operator and operand type
+	uint8_t		comp;			// FPB comparator of the breakpoint
+	uint16_t	count;			// Report every count-th true hit
+	uint16_t	hits;			// True hits since last report
+	uint16_t	skipped;		// Halts resumed by the probe
+	uint32_t	address;		// Breakpoint address
+	uint32_t	operand;		// Core register number or memory address
+	uint32_t	mask;			// Operand mask
+	uint32_t	value;			// Compare value
+} Condition[CONDITION_COUNT];
+
+// Check if any condition is active
+//	return:	1 = active condition, 0 = none
+static uint32_t Condition_Active(void)
+{
+	uint32_t n;
+
+	for (n = 0; n < CONDITION_COUNT; n++)
+	{
+		if ((Condition[n].op & COND_OP_MASK) != COND_OFF)
+			return (1);
+	}
+	return (0);
+}
+
+// Evaluate breakpoint condition of halted target
+//	pc:		program counter of halted target
+//	return:	1 = target resumed (condition false), 0 = report halt
+static uint32_t Condition_Halt(uint32_t pc)
+{
+	uint32_t data;
+	uint32_t result;
+	uint32_t n;
+	uint8_t  ack;
+
+	for (n = 0; n < CONDITION_COUNT; n++)
+	{
+		if (((Condition[n].op & COND_OP_MASK) != COND_OFF) && (Condition[n].address == pc))
+			break;
+	}
+	if (n == CONDITION_COUNT)
+		return (0);
+
+	if (Condition[n].op & COND_REGISTER)
+		ack = Monitor_ReadReg(Condition[n].operand, &data);
+	else
+		ack = MEM_AP_ReadWord(Condition[n].operand, &data);
+	if (ack != DAP_TRANSFER_OK)
+		return (0);
+
+	data &= Condition[n].mask;
+	switch (Condition[n].op & COND_OP_MASK)
+	{
+		case COND_EQ:	result = (data == Condition[n].value);	break;
+		case COND_NE:	result = (data != Condition[n].value);	break;
+		case COND_LT:	result = (data <  Condition[n].value);	break;
+		case COND_LE:	result = (data <= Condition[n].value);	break;
+		case COND_GT:	result = (data >  Condition[n].value);	break;
+		default:		result = (data >= Condition[n].value);	break;
+	}
+	if (result && (++Condition[n].hits >= Condition[n].count))
+	{
+		Condition[n].hits = 0;
+		return (0);
+	}
+
+	if (Monitor_StepOver(Condition[n].comp) != DAP_TRANSFER_OK)
+		return (0);
+
+	Condition[n].skipped++;
+	return (1);
+}
+
+#endif	/* (DAP_SWD_CONDITION != 0) */
+
+#if (DAP_SWD_TRACEPOINT != 0)
+
+// Tracepoints
+static struct {
+	uint8_t		enable;			// Tracepoint enabled
+	uint8_t		comp;			// FPB comparator of the breakpoint
+	uint8_t		ranges;			// Number of memory ranges
+	uint32_t	address;		// Breakpoint address
+	uint32_t	regs;			// Core registers (bit n = DCRSR REGSEL n)
+	uint32_t	mem_addr [TRACE_RANGES];	// Memory range address
+	uint8_t		mem_words[TRACE_RANGES];	// Memory range size in words
+} Tracepoint[TRACEPOINT_COUNT];
+
+// Trace ring buffer
+//	Record: tracepoint index, number of words, probe time (4), words (4 each)
+static uint8_t  Trace_Buffer[TRACE_BUFFER_SIZE];
+static uint32_t Trace_In;		// Write index
+static uint32_t Trace_Out;		// Read index
+static uint16_t Trace_Lost;		// Records lost by buffer overflow
+
+// Put byte into trace buffer (space is checked before)
+static __inline void Trace_Put(uint32_t data)
+{
+	Trace_Buffer[Trace_In] = (uint8_t)data;
+	if (++Trace_In == TRACE_BUFFER_SIZE)
+		Trace_In = 0;
+}
+
+// Check if any tracepoint is active
+//	return:	1 = active tracepoint, 0 = none
+static uint32_t Tracepoint_Active(void)
+{
+	uint32_t n;
+
+	for (n = 0; n < TRACEPOINT_COUNT; n++)
+	{
+		if (Tracepoint[n].enable)
+			return (1);
+	}
+	return (0);
+}
+
+// Capture tracepoint data of halted target and resume
+//	pc:		program counter of halted target
+//	return:	1 = target resumed, 0 = report halt
+static uint32_t Tracepoint_Halt(uint32_t pc)
+{
+	uint32_t data[21 + TRACE_RANGES * TRACE_WORDS];
+	uint32_t time;
+	uint32_t count;
+	uint32_t space;
+	uint32_t n, i;
+	uint8_t  ack;
+
+	time = DWT->CYCCNT;
+	for (n = 0; n < TRACEPOINT_COUNT; n++)
+	{
+		if (Tracepoint[n].enable && (Tracepoint[n].address == pc))
+			break;
+	}
+	if (n == TRACEPOINT_COUNT)
+		return (0);
+
+	// Core registers R0..R15, xPSR, MSP, PSP, CONTROL/FAULTMASK/BASEPRI/PRIMASK
+	ack   = DAP_TRANSFER_OK;
+	count = 0;
+	for (i = 0; (i < 21) && (ack == DAP_TRANSFER_OK); i++)
+	{
+		if (Tracepoint[n].regs & (1 << i))
+			ack = Monitor_ReadReg(i, &data[count++]);
+	}
+	// Memory ranges
+	for (i = 0; (i < Tracepoint[n].ranges) && (ack == DAP_TRANSFER_OK); i++)
+	{
+		ack = MEM_AP_ReadBlock(Tracepoint[n].mem_addr[i], &data[count], Tracepoint[n].mem_words[i]);
+		count += Tracepoint[n].mem_words[i];
+	}
+	if (ack != DAP_TRANSFER_OK)
+		return (0);
+
+	if (Monitor_StepOver(Tracepoint[n].comp) != DAP_TRANSFER_OK)
+		return (0);
+
+	space = (Trace_Out + TRACE_BUFFER_SIZE - Trace_In - 1) % TRACE_BUFFER_SIZE;
+	if (space < (2 + 4 + (count << 2)))
+	{
+		Trace_Lost++;
+		return (1);
+	}
+	Trace_Put(n);
+	Trace_Put(count);
+	Trace_Put(time >>  0);
+	Trace_Put(time >>  8);
+	Trace_Put(time >> 16);
+	Trace_Put(time >> 24);
+	for (i = 0; i < count; i++)
+	{
+		Trace_Put(data[i] >>  0);
+		Trace_Put(data[i] >>  8);
+		Trace_Put(data[i] >> 16);
+		Trace_Put(data[i] >> 24);
+	}
+	return (1);
+}
+
+#endif	/* (DAP_SWD_TRACEPOINT != 0) */
+
+#if (DAP_SWD_SEMIHOST != 0)
+
+// Semihosting operations
+#define SYS_WRITEC			0x03	// Write character (R1: pointer to character)
+#define SYS_WRITE0			0x04	// Write string (R1: pointer to zero terminated string)
+#define SYS_WRITE			0x05	// Write to file (R1: pointer to handle, buffer, length)
+
+// Semihosting breakpoint instruction (BKPT 0xAB, Thumb)
+#define BKPT_SEMIHOST		0xBEAB
+
+static struct {
+	uint8_t		enable;			// Semihosting fast path enabled
+	uint8_t		pending;		// Halted operation waits for COM port output
+	uint8_t		string;			// 1 = output stops at zero terminator
+	uint8_t		result;			// 1 = write number of bytes not sent to R0 (SYS_WRITE)
+	uint16_t	host;			// Operations passed to the host
+	uint32_t	bytes;			// Bytes sent to COM port
+	uint32_t	pc;				// Program counter of the halted operation
+	uint32_t	addr;			// Target address of text not yet read
+	uint32_t	count;			// Bytes of text not yet read
+	uint32_t	lost;			// Bytes discarded by timeout
+	uint32_t	time;			// Time of last COM port progress (DWT CYCCNT)
+} Semihost;
+
+static uint8_t  Semihost_Text[SEMIHOST_CHUNK];	// Text read from target, not yet sent
+static uint32_t Semihost_TextCount;
+static uint32_t Semihost_TextSent;
+
+// Read next chunk of text from target memory
+//	return:	ACK[2:0]
+static uint8_t Semihost_Read(void)
+{
+	uint32_t data[(SEMIHOST_CHUNK >> 2) + 1];
+	uint32_t addr;
+	uint32_t n, k;
+	uint8_t  ack;
+
+	addr = Semihost.addr;
+	n = SEMIHOST_CHUNK;
+	if (n > Semihost.count)
+		n = Semihost.count;
+	ack = MEM_AP_ReadBlock(addr & ~3, data, ((addr & 3) + n + 3) >> 2);
+	if (ack != DAP_TRANSFER_OK)
+		return (ack);
+	for (k = 0; k < n; k++)
+	{
+		Semihost_Text[k] = (uint8_t)(data[((addr & 3) + k) >> 2] >> ((((addr & 3) + k) & 3) << 3));
+		if (Semihost.string && (Semihost_Text[k] == 0))
+		{
+			n = Semihost.count = k;
+			break;
+		}
+	}
+	Semihost_TextCount = n;
+	Semihost_TextSent  = 0;
+	Semihost.addr  += n;
+	Semihost.count -= n;
+	return (DAP_TRANSFER_OK);
+}
+
+// Complete halted operation: write result and continue after BKPT instruction
+//	return:	ACK[2:0]
+static uint8_t Semihost_Resume(void)
+{
+	uint32_t data;
+	uint8_t  ack;
+
+	// Target must still be halted at the operation (not resumed or reset by the debugger)
+	ack = MEM_AP_ReadWord(DBG_HCSR, &data);
+	if ((ack == DAP_TRANSFER_OK) && ((data & S_HALT) == 0))
+		return (DAP_TRANSFER_ERROR);
+	if (ack == DAP_TRANSFER_OK)
+		ack = Monitor_ReadReg(15, &data);
+	if ((ack == DAP_TRANSFER_OK) && (data != Semihost.pc))
+		return (DAP_TRANSFER_ERROR);
+
+	if ((ack == DAP_TRANSFER_OK) && Semihost.result)
+		ack = Monitor_WriteReg(0, Semihost.lost);	// Number of bytes not written
+	if (ack == DAP_TRANSFER_OK)
+		ack = Monitor_WriteReg(15, Semihost.pc + 2);
+	if (ack == DAP_TRANSFER_OK)
+		ack = MEM_AP_WriteWord(DBG_DFSR, DFSR_BKPT | DFSR_HALTED);
+	if (ack == DAP_TRANSFER_OK)
+		ack = Monitor_Resume(0);
+	return (ack);
+}
+
+// Send semihosting output to COM port (called while no USB request is pending)
+//   Text of the halted operation is read in chunks and sent without waiting
+//   for the USB endpoint. The target is resumed when all text is sent or
+//   discarded (COM port not read by the host for SEMIHOST_TIMEOUT).
+//	return:	none
+static void Semihost_Idle(void)
+{
+	int32_t n;
+	uint8_t ack;
+
+	if (Semihost_TextSent < Semihost_TextCount)
+	{
+		n = pCoreDescriptor->CdcWrite(&Semihost_Text[Semihost_TextSent], Semihost_TextCount - Semihost_TextSent);
+		if (n > 0)
+		{
+			Semihost_TextSent += n;
+			Semihost.bytes    += n;
+			Semihost.time = DWT->CYCCNT;
+		}
+		else if ((DWT->CYCCNT - Semihost.time) > (SEMIHOST_TIMEOUT * (CPU_CLOCK / 1000)))
+		{	// COM port is not read by the host: discard output
+			Semihost.lost += (Semihost_TextCount - Semihost_TextSent) + Semihost.count;
+			Semihost_TextCount = 0;
+			Semihost_TextSent  = 0;
+			Semihost.count     = 0;
+		}
+		return;
+	}
+	if (!Semihost.pending || (DAP_Data.debug_port != DAP_PORT_SWD))
+		return;
+
+	ack = Monitor_Begin();
+	if ((ack == DAP_TRANSFER_OK) && Semihost.count)
+	{
+		ack = Semihost_Read();
+		if (ack == DAP_TRANSFER_OK)
+		{
+			Monitor_End(ack);
+			return;
+		}
+	}
+	else if (ack == DAP_TRANSFER_OK)
+	{
+		ack = Semihost_Resume();
+	}
+	Monitor_End(ack);
+	if (ack != DAP_TRANSFER_OK)
+	{	// Halt is reported by the next monitor poll
+		Monitor.valid = 0;
+	}
+	Semihost.pending = 0;
+}
+
+// Start semihosting console output of halted target
+//   The output is sent by Semihost_Idle, the target stays halted until then.
+//	pc:		program counter of halted target
+//	return:	1 = handled by the probe, 0 = report halt (pass to host)
+static uint32_t Semihost_Halt(uint32_t pc)
+{
+	uint32_t data[3];
+	uint32_t op;
+	uint32_t param;
+	uint8_t  ack;
+
+	ack = MEM_AP_ReadWord(pc & ~3, &data[0]);
+	if ((ack != DAP_TRANSFER_OK) || (((data[0] >> ((pc & 2) << 3)) & 0xFFFF) != BKPT_SEMIHOST))
+		return (0);
+
+	ack = Monitor_ReadReg(0, &op);
+	if (ack == DAP_TRANSFER_OK)
+		ack = Monitor_ReadReg(1, &param);
+	if (ack != DAP_TRANSFER_OK)
+		return (0);
+
+	Semihost.result = 0;
+	switch (op)
+	{
+		case SYS_WRITEC:
+			Semihost.addr   = param;
+			Semihost.count  = 1;
+			Semihost.string = 0;
+			break;
+		case SYS_WRITE0:
+			Semihost.addr   = param;
+			Semihost.count  = SEMIHOST_STRING;
+			Semihost.string = 1;
+			break;
+		case SYS_WRITE:
+			// Handle, buffer, length: only stdout/stderr are console handles
+			ack = MEM_AP_ReadBlock(param, data, 3);
+			if ((ack != DAP_TRANSFER_OK) || ((data[0] != 1) && (data[0] != 2)))
+			{
+				Semihost.host++;
+				return (0);
+			}
+			Semihost.addr   = data[1];
+			Semihost.count  = data[2];
+			Semihost.string = 0;
+			Semihost.result = 1;
+			break;
+		default:
+			Semihost.host++;
+			return (0);
+	}
+
+	Semihost.pc      = pc;
+	Semihost.lost    = 0;
+	Semihost.time    = DWT->CYCCNT;
+	Semihost.pending = 1;
+	return (1);
+}
+
+#endif	/* (DAP_SWD_SEMIHOST != 0) */
+
+// Check if halts are handled by the probe
+//	return:	1 = poll without monitor period (probe handles halts), 0 = use period
+static uint32_t Monitor_Fast(void)
+{
+#if (DAP_SWD_CONDITION != 0)
+	if (Condition_Active())
+		return (1);
+#endif
+#if (DAP_SWD_TRACEPOINT != 0)
+	if (Tracepoint_Active())
+		return (1);
+#endif
+#if (DAP_SWD_SEMIHOST != 0)
+	if (Semihost.enable)
+		return (1);
+#endif
+	return (0);
+}
+
+// Process halt of the target
+//	return:	1 = target resumed by the probe, 0 = report halt
+static uint32_t Monitor_Halt(void)
+{
+	uint32_t dfsr;
+	uint32_t pc;
+	uint32_t resumed;
+	uint8_t  ack;
+
+	resumed = 0;
+	ack = Monitor_Begin();
+	if (ack == DAP_TRANSFER_OK)
+		ack = MEM_AP_ReadWord(DBG_DFSR, &dfsr);
+	if ((ack == DAP_TRANSFER_OK) && (dfsr & DFSR_BKPT))
+	{	// Halt on breakpoint
+		ack = Monitor_ReadReg(15, &pc);
+#if (DAP_SWD_SEMIHOST != 0)
+		if ((ack == DAP_TRANSFER_OK) && Semihost.enable && Semihost_Halt(pc))
+			resumed = 1;
+#endif
+#if (DAP_SWD_CONDITION != 0)
+		if ((ack == DAP_TRANSFER_OK) && !resumed && Condition_Halt(pc))
+			resumed = 1;
+#endif
+#if (DAP_SWD_TRACEPOINT != 0)
+		if ((ack == DAP_TRANSFER_OK) && !resumed && Tracepoint_Halt(pc))
+			resumed = 1;
+#endif
+	}
+	Monitor_End(ack);
+	return (resumed);
+}
+
+// Poll target run state (called while no USB request is pending)
+//	dhcsr:	pointer to DHCSR value
+//	return:	1 = run state changed or target reset, 0 = no change
+static uint32_t Monitor_Poll(uint32_t *dhcsr)
+{
+	uint32_t time;
+	uint32_t data;
+
+	if (!Monitor.enable || (DAP_Data.debug_port != DAP_PORT_SWD))
+		return (0);
+#if (DAP_SWD_SEMIHOST != 0)
+	if (Semihost.pending)
+	{	// Target is halted by a semihosting operation in progress
+		return (0);
+	}
+#endif
+
+	time = DWT->CYCCNT;
+	if (((time - Monitor.time) < Monitor.period) && !Monitor_Fast())
+		return (0);
+	Monitor.time = time;
+
+	if (Monitor_ReadWord(DBG_HCSR, &data) != DAP_TRANSFER_OK)
+	{	// Target not accessible: report state after next successful read
+		Monitor.valid = 0;
+		return (0);
+	}
+
+	if (Monitor.valid &&
+		(((data ^ Monitor.dhcsr) & MONITOR_STATE) == 0) &&
+		((data & S_RESET_ST) == 0))
+	{
+		Monitor.dhcsr = data;
+		return (0);
+	}
+
+	if ((data & S_HALT) && Monitor_Halt())
+	{	// Halt handled by the probe, target is running
+		Monitor.dhcsr = data & ~S_HALT;
+		Monitor.valid = 1;
+		return (0);
+	}
+
+	Monitor.dhcsr = data;
+	Monitor.valid = 1;
+	Monitor.events++;
+	*dhcsr = data;
+	return (1);
+}
+
+#endif	/* ((DAP_SWD != 0) && (DAP_SWD_MONITOR != 0)) */
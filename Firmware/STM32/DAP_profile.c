@@ -0,0 +1,112 @@
+/******************************************************************************
+ * @file	DAP_profile.c
+ * @brief	CMSIS-DAP statistical PC sampling profiler (STM32)
+ *
+ * While no USB request is pending, the target DWT PCSR register is read in
+ * bursts of posted MEM-AP reads (one SWD transfer per sample). Samples are
+ * accumulated into a histogram of PROFILE_BINS address bins starting at the
+ * profile base address; the host reads the histogram in bulk.
+ ******************************************************************************/
+
+#include "DAP_config.h"
+#include "..\DAP.h"
+
+#if ((DAP_SWD != 0) && (DAP_SWD_MONITOR != 0) && (DAP_SWD_PROFILE != 0))
+
+// DWT Program Counter Sample Register
+#define DWT_PCSR			0xE000101C
+
+// PCSR value while the core is halted
+#define PCSR_HALTED			0xFFFFFFFF
+
+static struct {
+	uint8_t		enable;			// Profiler running
+	uint8_t		shift;			// Bin size (log2 bytes)
+	uint32_t	base;			// Address of bin 0
+	uint32_t	samples;		// Number of samples
+	uint32_t	outside;		// Samples outside of histogram
+	uint32_t	halted;			// Samples with halted core
+} Profile;
+
+static uint16_t Profile_Bins[PROFILE_BINS];		// Histogram (saturated)
+
+
+// Start or stop profiler
+//	enable:	1 = start with cleared histogram, 0 = stop
+//	base:	address of bin 0
+//	shift:	bin size (log2 bytes)
+//	return:	none
+static void Profile_Setup(uint32_t enable, uint32_t base, uint32_t shift)
+{
+	uint32_t n;
+
+	if (enable)
+	{
+		for (n = 0; n < PROFILE_BINS; n++)
+			Profile_Bins[n] = 0;
+		Profile.base    = base;
+		Profile.shift   = shift;
+		Profile.samples = 0;
+		Profile.outside = 0;
+		Profile.halted  = 0;
+	}
+	Profile.enable = enable;
+}
+
+// Add PC sample to histogram
+static __inline void Profile_Add(uint32_t pc)
+{
+	uint32_t bin;
+
+	Profile.samples++;
+	if (pc == PCSR_HALTED)
+	{
+		Profile.halted++;
+		return;
+	}
+	bin = (pc - Profile.base) >> Profile.shift;
+	if (bin >= PROFILE_BINS)
+	{
+		Profile.outside++;
+		return;
+	}
+	if (Profile_Bins[bin] != 0xFFFF)
+		Profile_Bins[bin]++;
+}
+
+// Sample PCSR burst (called while no USB request is pending)
+//	The burst ends early when a USB request arrives.
+//	return:	none
+static void Profile_Idle(void)
+{
+	uint32_t pc;
+	uint32_t n;
+	uint8_t  ack;
+
+	if (!Profile.enable || (DAP_Data.debug_port != DAP_PORT_SWD))
+		return;
+
+	ack = Monitor_Begin();
+	if (ack == DAP_TRANSFER_OK)
+		ack = AP_Write(AP_TAR, DWT_PCSR);
+	if (ack == DAP_TRANSFER_OK)
+	{	// Post first read, every next read returns previous sample
+		ack = SWD_TransferRetry(AP_DRW | DAP_TRANSFER_APnDP | DAP_TRANSFER_RnW, NULL);
+		for (n = PROFILE_BURST - 1; (n != 0) && (ack == DAP_TRANSFER_OK) && !Monitor_Preempt(); n--)
+		{
+			ack = SWD_TransferRetry(AP_DRW | DAP_TRANSFER_APnDP | DAP_TRANSFER_RnW, &pc);
+			if (ack == DAP_TRANSFER_OK)
+				Profile_Add(pc);
+		}
+		if (ack == DAP_TRANSFER_OK)
+			ack = DP_Read(DP_RDBUFF, &pc);
+		if (ack == DAP_TRANSFER_OK)
+			Profile_Add(pc);
+	}
+	if (Monitor_End(ack) != DAP_TRANSFER_OK)
+	{	// Target not accessible
+		Profile.enable = 0;
+	}
+}
+
+#endif	/* ((DAP_SWD != 0) && (DAP_SWD_MONITOR != 0) && (DAP_SWD_PROFILE != 0)) */
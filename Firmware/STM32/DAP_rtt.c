@@ -0,0 +1,287 @@
+/******************************************************************************
+ * @file	DAP_rtt.c
+ * @brief	CMSIS-DAP RTT (Real Time Transfer) bridge to virtual COM port (STM32)
+ *
+ * The RTT control block is set by address or found by a scan for its ID
+ * string. While no USB request is pending, the selected up-buffer is polled and
+ * new data is read with MEM-AP block reads and sent to the virtual COM port;
+ * data received from the virtual COM port is written into the down-buffer.
+ * The virtual COM port is claimed from the UART bridge while RTT is running.
+ ******************************************************************************/
+
+#include "DAP_config.h"
+#include "..\DAP.h"
+
+#if ((DAP_SWD != 0) && (DAP_SWD_MONITOR != 0) && (DAP_SWD_RTT != 0))
+
+// RTT control block
+#define RTT_ID_WORDS		4		// "SEGGER RTT" (16 bytes)
+#define RTT_MAX_UP			16		// Offset of MaxNumUpBuffers
+#define RTT_MAX_DOWN		20		// Offset of MaxNumDownBuffers
+#define RTT_BUFFERS			24		// Offset of buffer descriptors
+#define RTT_BUFFER_SIZE		24		// Size of buffer descriptor
+#define RTT_BUFFER_PTR		4		// Offset of pBuffer (sName, pBuffer, SizeOfBuffer, WrOff, RdOff, Flags)
+#define RTT_BUFFER_WROFF	12		// Offset of WrOff
+#define RTT_BUFFER_RDOFF	16		// Offset of RdOff
+
+// RTT states
+#define RTT_OFF				0		// Not running
+#define RTT_SCAN			1		// Scan for control block
+#define RTT_RUN				2		// Control block found, bridge running
+#define RTT_NOT_FOUND		3		// Control block not found
+
+static const uint32_t Rtt_ID[RTT_ID_WORDS] = {
+	0x47474553,		// "SEGG"
+	0x52205245,		// "ER R"
+	0x00005454,		// "TT\0\0"
+	0x00000000
+};
+
+static struct {
+	uint8_t		state;			// RTT state
+	uint8_t		up;				// Up-buffer index (target -> COM port)
+	uint8_t		down;			// Down-buffer index (COM port -> target)
+	uint32_t	addr;			// Control block address (or scan address)
+	uint32_t	end;			// Scan end address
+	uint32_t	up_desc;		// Up-buffer descriptor address
+	uint32_t	down_desc;		// Down-buffer descriptor address (0 = none)
+	uint32_t	time;			// Time of last poll (DWT CYCCNT)
+	uint32_t	up_bytes;		// Bytes sent to COM port
+} Rtt;
+
+static uint8_t  Rtt_Tx[RTT_CHUNK];		// Data read from up-buffer, not yet sent
+static uint32_t Rtt_TxCount;
+static uint32_t Rtt_TxSent;
+static uint8_t  Rtt_Rx[RTT_CHUNK];		// Data received from COM port, not yet written
+static uint32_t Rtt_RxCount;
+
+
+// Start or stop RTT bridge
+//	mode:	0 = stop, 1 = control block at address, 2 = scan address range
+//	addr:	control block address or scan start address
+//	size:	scan size in bytes
+//	up:		up-buffer index
+//	down:	down-buffer index
+//	return:	none
+static void Rtt_Setup(uint32_t mode, uint32_t addr, uint32_t size, uint32_t up, uint32_t down)
+{
+	Rtt.state    = RTT_OFF;
+	Rtt_TxCount  = 0;
+	Rtt_TxSent   = 0;
+	Rtt_RxCount  = 0;
+	if ((pCoreDescriptor->CdcClaim == NULL) || (mode == 0) || (mode > 2))
+	{
+		if (pCoreDescriptor->CdcClaim != NULL)
+			pCoreDescriptor->CdcClaim(0);
+		return;
+	}
+
+	// Probe DWT cycle counter as time base
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+
+	Rtt.up       = up;
+	Rtt.down     = down;
+	Rtt.addr     = addr & ~3;
+	Rtt.end      = Rtt.addr + size;
+	Rtt.up_bytes = 0;
+	Rtt.time     = DWT->CYCCNT;
+	Rtt.state    = RTT_SCAN;
+	if (mode == 1)
+	{	// Check ID at given address only
+		Rtt.end  = Rtt.addr + (RTT_ID_WORDS << 2);
+	}
+	pCoreDescriptor->CdcClaim(1);
+}
+
+// Scan next block for control block ID and read buffer descriptors
+//	return:	ACK[2:0]
+static uint8_t Rtt_Scan(void)
+{
+	uint32_t data[RTT_SCAN_WORDS + RTT_ID_WORDS - 1];
+	uint32_t words;
+	uint32_t n, k;
+	uint8_t  ack;
+
+	if (Rtt.addr >= Rtt.end)
+	{
+		Rtt.state = RTT_NOT_FOUND;
+		pCoreDescriptor->CdcClaim(0);
+		return (DAP_TRANSFER_OK);
+	}
+	words = (Rtt.end - Rtt.addr) >> 2;
+	if (words > (RTT_SCAN_WORDS + RTT_ID_WORDS - 1))
+		words = RTT_SCAN_WORDS + RTT_ID_WORDS - 1;
+	if (words < RTT_ID_WORDS)
+	{
+		Rtt.addr = Rtt.end;
+		return (DAP_TRANSFER_OK);
+	}
+
+	ack = MEM_AP_ReadBlock(Rtt.addr, data, words);
+	if (ack != DAP_TRANSFER_OK)
+		return (ack);
+
+	for (n = 0; n <= (words - RTT_ID_WORDS); n++)
+	{
+		for (k = 0; (k < RTT_ID_WORDS) && (data[n + k] == Rtt_ID[k]); k++)
+		{ }
+		if (k == RTT_ID_WORDS)
+			break;
+	}
+	if (n > (words - RTT_ID_WORDS))
+	{	// Next block overlaps by ID size
+		Rtt.addr += (words - RTT_ID_WORDS + 1) << 2;
+		return (DAP_TRANSFER_OK);
+	}
+
+	// Control block found: check buffer indexes
+	Rtt.addr += n << 2;
+	ack = MEM_AP_ReadBlock(Rtt.addr + RTT_MAX_UP, data, 2);
+	if (ack != DAP_TRANSFER_OK)
+		return (ack);
+	if (Rtt.up >= data[0])
+	{
+		Rtt.state = RTT_NOT_FOUND;
+		pCoreDescriptor->CdcClaim(0);
+		return (DAP_TRANSFER_OK);
+	}
+	Rtt.up_desc   = Rtt.addr + RTT_BUFFERS + Rtt.up * RTT_BUFFER_SIZE;
+	Rtt.down_desc = 0;
+	if (Rtt.down < data[1])
+		Rtt.down_desc = Rtt.addr + RTT_BUFFERS + (data[0] + Rtt.down) * RTT_BUFFER_SIZE;
+	Rtt.state = RTT_RUN;
+	return (DAP_TRANSFER_OK);
+}
+
+// Read new data of up-buffer
+//	return:	ACK[2:0]
+static uint8_t Rtt_ReadUp(void)
+{
+	uint32_t data[(RTT_CHUNK >> 2) + 1];
+	uint32_t desc[4];			// pBuffer, SizeOfBuffer, WrOff, RdOff
+	uint32_t count;
+	uint32_t addr;
+	uint32_t n;
+	uint8_t  ack;
+
+	ack = MEM_AP_ReadBlock(Rtt.up_desc + RTT_BUFFER_PTR, desc, 4);
+	if ((ack != DAP_TRANSFER_OK) || (desc[2] == desc[3]) ||
+		(desc[2] >= desc[1]) || (desc[3] >= desc[1]))
+	{
+		return (ack);
+	}
+
+	// Contiguous data from RdOff
+	count = ((desc[2] > desc[3]) ? desc[2] : desc[1]) - desc[3];
+	if (count > RTT_CHUNK)
+		count = RTT_CHUNK;
+
+	addr = desc[0] + desc[3];
+	ack = MEM_AP_ReadBlock(addr & ~3, data, ((addr & 3) + count + 3) >> 2);
+	if (ack != DAP_TRANSFER_OK)
+		return (ack);
+	for (n = 0; n < count; n++)
+	{
+		Rtt_Tx[n] = (uint8_t)(data[((addr & 3) + n) >> 2] >> ((((addr & 3) + n) & 3) << 3));
+	}
+
+	desc[3] += count;
+	if (desc[3] == desc[1])
+		desc[3] = 0;
+	ack = MEM_AP_WriteWord(Rtt.up_desc + RTT_BUFFER_RDOFF, desc[3]);
+	if (ack == DAP_TRANSFER_OK)
+	{
+		Rtt_TxCount = count;
+		Rtt_TxSent  = 0;
+	}
+	return (ack);
+}
+
+// Write received data into down-buffer
+//	return:	ACK[2:0]
+static uint8_t Rtt_WriteDown(void)
+{
+	uint32_t desc[4];			// pBuffer, SizeOfBuffer, WrOff, RdOff
+	uint32_t count;
+	uint32_t n;
+	uint8_t  ack;
+
+	ack = MEM_AP_ReadBlock(Rtt.down_desc + RTT_BUFFER_PTR, desc, 4);
+	if ((ack != DAP_TRANSFER_OK) || (desc[2] >= desc[1]) || (desc[3] >= desc[1]))
+		return (ack);
+
+	// Contiguous free space from WrOff
+	if (desc[3] > desc[2])
+		count = desc[3] - desc[2] - 1;
+	else
+		count = desc[1] - desc[2] - ((desc[3] == 0) ? 1 : 0);
+	if (count > Rtt_RxCount)
+		count = Rtt_RxCount;
+	if (count == 0)
+		return (DAP_TRANSFER_OK);
+
+	ack = MEM_AP_WriteBytes(desc[0] + desc[2], Rtt_Rx, count);
+	if (ack != DAP_TRANSFER_OK)
+		return (ack);
+	desc[2] += count;
+	if (desc[2] == desc[1])
+		desc[2] = 0;
+	ack = MEM_AP_WriteWord(Rtt.down_desc + RTT_BUFFER_WROFF, desc[2]);
+	if (ack == DAP_TRANSFER_OK)
+	{
+		Rtt_RxCount -= count;
+		for (n = 0; n < Rtt_RxCount; n++)
+			Rtt_Rx[n] = Rtt_Rx[n + count];
+	}
+	return (ack);
+}
+
+// Poll RTT buffers (called while no USB request is pending)
+//	return:	none
+static void Rtt_Idle(void)
+{
+	uint32_t time;
+	uint8_t  ack;
+
+	if (((Rtt.state != RTT_SCAN) && (Rtt.state != RTT_RUN)) ||
+		(DAP_Data.debug_port != DAP_PORT_SWD))
+	{
+		return;
+	}
+
+	// Send pending data to COM port
+	if (Rtt_TxSent < Rtt_TxCount)
+	{
+		Rtt_TxSent += pCoreDescriptor->CdcWrite(&Rtt_Tx[Rtt_TxSent], Rtt_TxCount - Rtt_TxSent);
+		if (Rtt_TxSent < Rtt_TxCount)
+			return;
+		Rtt.up_bytes += Rtt_TxCount;
+		Rtt_TxCount = 0;
+	}
+	if (Rtt_RxCount < RTT_CHUNK)
+		Rtt_RxCount += pCoreDescriptor->CdcRead(&Rtt_Rx[Rtt_RxCount], RTT_CHUNK - Rtt_RxCount);
+
+	time = DWT->CYCCNT;
+	if ((time - Rtt.time) < (RTT_PERIOD * (CPU_CLOCK / 1000000)))
+		return;
+	Rtt.time = time;
+
+	ack = Monitor_Begin();
+	if (ack == DAP_TRANSFER_OK)
+	{
+		if (Rtt.state == RTT_SCAN)
+		{
+			ack = Rtt_Scan();
+		}
+		else
+		{
+			ack = Rtt_ReadUp();
+			if ((ack == DAP_TRANSFER_OK) && Rtt_RxCount && Rtt.down_desc)
+				ack = Rtt_WriteDown();
+		}
+	}
+	Monitor_End(ack);
+}
+
+#endif	/* ((DAP_SWD != 0) && (DAP_SWD_MONITOR != 0) && (DAP_SWD_RTT != 0)) */
@@ -0,0 +1,183 @@
+/******************************************************************************
+ * @file	DAP_sample.c
+ * @brief	CMSIS-DAP live variable sampler (STM32)
+ *
+ * The host registers a list of target memory items (word aligned address,
+ * number of words) and a sample period. Items with neighboring addresses are
+ * coalesced into MEM-AP block reads. Samples are taken at a fixed rate (probe
+ * DWT cycle counter) while no USB request is pending and are stored with a
+ * time stamp into the sample buffer, which the host reads in bulk.
+ ******************************************************************************/
+
+#include "DAP_config.h"
+#include "..\DAP.h"
+
+#if ((DAP_SWD != 0) && (DAP_SWD_MONITOR != 0) && (DAP_SWD_SAMPLE != 0))
+
+static struct {
+	uint8_t		enable;			// Sampler running
+	uint8_t		items;			// Number of items
+	uint8_t		ranges;			// Number of coalesced block reads
+	uint16_t	words;			// Words per sample (all items)
+	uint16_t	lost;			// Samples lost by buffer overflow
+	uint16_t	missed;			// Sample periods missed
+	uint32_t	period;			// Sample period in CPU cycles
+	uint32_t	next;			// Time of next sample (DWT CYCCNT)
+} Sample;
+
+static struct {
+	uint32_t	addr;			// Item address
+	uint8_t		words;			// Item size in words
+	uint8_t		offset;			// Word offset in block read data
+} Sample_Item[SAMPLE_ITEMS];
+
+static struct {
+	uint32_t	addr;			// Block read address
+	uint8_t		words;			// Block read size in words
+} Sample_Range[SAMPLE_ITEMS];
+
+// Sample ring buffer
+//	Record: probe time (4), item words (4 each) in order of registration
+static uint8_t  Sample_Buffer[SAMPLE_BUFFER_SIZE];
+static uint32_t Sample_In;		// Write index
+static uint32_t Sample_Out;		// Read index
+
+
+// Coalesce items into block reads
+//	return:	0 = ok, 1 = empty item or too many words
+static uint32_t Sample_Coalesce(void)
+{
+	uint8_t  order[SAMPLE_ITEMS];
+	uint32_t addr, end;
+	uint32_t total;
+	uint32_t n, k, i;
+
+	// Sort items by address
+	for (n = 0; n < Sample.items; n++)
+	{
+		for (k = n; (k != 0) && (Sample_Item[order[k - 1]].addr > Sample_Item[n].addr); k--)
+			order[k] = order[k - 1];
+		order[k] = n;
+	}
+
+	Sample.ranges = 0;
+	Sample.words  = 0;
+	total = 0;
+	end   = 0;
+	for (n = 0; n < Sample.items; n++)
+	{
+		i    = order[n];
+		addr = Sample_Item[i].addr;
+		if (Sample_Item[i].words == 0)
+			return (1);
+		if ((Sample.ranges == 0) || (addr > (end + (SAMPLE_GAP << 2))))
+		{	// Start new block read
+			if (Sample.ranges != 0)
+				total += Sample_Range[Sample.ranges - 1].words;
+			Sample_Range[Sample.ranges].addr = addr;
+			Sample.ranges++;
+			end = addr;
+		}
+		if ((addr + (Sample_Item[i].words << 2)) > end)
+			end = addr + (Sample_Item[i].words << 2);
+		Sample_Item[i].offset = total + ((addr - Sample_Range[Sample.ranges - 1].addr) >> 2);
+		Sample_Range[Sample.ranges - 1].words = (end - Sample_Range[Sample.ranges - 1].addr) >> 2;
+		Sample.words += Sample_Item[i].words;
+		if ((total + Sample_Range[Sample.ranges - 1].words) > SAMPLE_WORDS)
+			return (1);
+	}
+	// Record (time stamp and item words) must fit into sample buffer
+	if ((Sample.words > SAMPLE_WORDS) || ((4 + (Sample.words << 2)) > (SAMPLE_BUFFER_SIZE - 1)))
+		return (1);
+	return (0);
+}
+
+// Start or stop sampler (items are set before)
+//	enable:	1 = start, 0 = stop
+//	period:	sample period in us
+//	return:	0 = ok, 1 = invalid item list
+static uint32_t Sample_Setup(uint32_t enable, uint32_t period)
+{
+	Sample.enable = 0;
+	if (!enable)
+		return (0);
+	if ((Sample.items == 0) || (period == 0) || Sample_Coalesce())
+		return (1);
+
+	// Probe DWT cycle counter as time base
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+
+	Sample_In     = 0;
+	Sample_Out    = 0;
+	Sample.lost   = 0;
+	Sample.missed = 0;
+	Sample.period = period * (CPU_CLOCK / 1000000);
+	Sample.next   = DWT->CYCCNT;
+	Sample.enable = 1;
+	return (0);
+}
+
+// Put byte into sample buffer (space is checked before)
+static __inline void Sample_Put(uint32_t data)
+{
+	Sample_Buffer[Sample_In] = (uint8_t)data;
+	if (++Sample_In == SAMPLE_BUFFER_SIZE)
+		Sample_In = 0;
+}
+
+// Take sample when due (called while no USB request is pending)
+//	return:	none
+static void Sample_Idle(void)
+{
+	uint32_t data[SAMPLE_WORDS];
+	uint32_t time;
+	uint32_t space;
+	uint32_t n, k;
+	uint8_t  ack;
+
+	if (!Sample.enable || (DAP_Data.debug_port != DAP_PORT_SWD))
+		return;
+
+	time = DWT->CYCCNT;
+	if ((int32_t)(time - Sample.next) < 0)
+		return;
+	Sample.next += Sample.period;
+	if ((int32_t)(time - Sample.next) >= 0)
+	{	// Late by more than one period: restart schedule
+		Sample.missed++;
+		Sample.next = time + Sample.period;
+	}
+
+	ack = Monitor_Begin();
+	for (n = 0, k = 0; (n < Sample.ranges) && (ack == DAP_TRANSFER_OK); n++)
+	{
+		ack = MEM_AP_ReadBlock(Sample_Range[n].addr, &data[k], Sample_Range[n].words);
+		k += Sample_Range[n].words;
+	}
+	if (Monitor_End(ack) != DAP_TRANSFER_OK)
+		return;
+
+	space = (Sample_Out + SAMPLE_BUFFER_SIZE - Sample_In - 1) % SAMPLE_BUFFER_SIZE;
+	if (space < (4 + (Sample.words << 2)))
+	{
+		Sample.lost++;
+		return;
+	}
+	Sample_Put(time >>  0);
+	Sample_Put(time >>  8);
+	Sample_Put(time >> 16);
+	Sample_Put(time >> 24);
+	for (n = 0; n < Sample.items; n++)
+	{
+		for (k = Sample_Item[n].offset; k < (Sample_Item[n].offset + Sample_Item[n].words); k++)
+		{
+			Sample_Put(data[k] >>  0);
+			Sample_Put(data[k] >>  8);
+			Sample_Put(data[k] >> 16);
+			Sample_Put(data[k] >> 24);
+		}
+	}
+}
+
+#endif	/* ((DAP_SWD != 0) && (DAP_SWD_MONITOR != 0) && (DAP_SWD_SAMPLE != 0)) */
@@ -0,0 +1,915 @@
+/**************************************************************************//**
+ * @file	DAP_vendor.c
+ * @brief	CMSIS-DAP Vendor Commands (STM32)
+ *
+ * Vendor commands use the Command IDs ID_DAP_Vendor0 .. ID_DAP_Vendor31.
+ * Response starts with the Command ID followed by the command data.
+ ******************************************************************************/
+
+#include "DAP_config.h"
+#include "..\DAP.h"
+
+#if (DAP_VENDOR_COMMANDS != 0)
+
+// Vendor Command IDs
+#define ID_DAP_AutoClock			ID_DAP_Vendor0
+#define ID_DAP_Attach				ID_DAP_Vendor1
+#define ID_DAP_Recovery				ID_DAP_Vendor2
+#define ID_DAP_GangSetup			ID_DAP_Vendor3
+#define ID_DAP_GangSequence			ID_DAP_Vendor4
+#define ID_DAP_GangTransfer			ID_DAP_Vendor5
+#define ID_DAP_Monitor				ID_DAP_Vendor6
+#define ID_DAP_Condition			ID_DAP_Vendor7
+#define ID_DAP_Tracepoint			ID_DAP_Vendor8
+#define ID_DAP_TraceRead			ID_DAP_Vendor9
+#define ID_DAP_Profile				ID_DAP_Vendor10
+#define ID_DAP_ProfileRead			ID_DAP_Vendor11
+#define ID_DAP_Sample				ID_DAP_Vendor12
+#define ID_DAP_SampleRead			ID_DAP_Vendor13
+#define ID_DAP_Rtt					ID_DAP_Vendor14
+#define ID_DAP_Semihost				ID_DAP_Vendor15
+
+// Unsolicited report (second byte instead of status)
+#define DAP_MONITOR_EVENT			0x80		// Target run state changed
+
+// DAP Attach options
+#define DAP_ATTACH_RESET			(1 << 0)	// Connect under reset (nRESET low during attach)
+#define DAP_ATTACH_HALT				(1 << 1)	// Halt core on reset vector (with DAP_ATTACH_RESET)
+
+
+// Process Auto Clock command and prepare response
+//   request:  pointer to request data
+//             mode: 0 = disable, 1 = enable, 0xFF = read status only
+//   response: pointer to response data
+//   return:   number of bytes in response
+//             (status, enabled, actual clock in Hz (4), number of downshifts (2))
+#if ((DAP_SWD != 0) && (DAP_SWD_AUTO_CLOCK != 0))
+static uint32_t DAP_AutoClock(uint8_t *request, uint8_t *response)
+{
+	uint32_t clock;
+
+	if (*request != 0xFF)
+	{
+		DAP_Data.auto_clock.enable    = (*request != 0) ? 1 : 0;
+		DAP_Data.auto_clock.downshift = 0;
+		DAP_Data.auto_clock.good      = 0;
+		// Restart from clock set by DAP_SWJ_Clock
+		DAP_Data.auto_clock.clock = SWJ_ClockSet(DAP_Data.auto_clock.limit);
+	}
+
+	DEBUG("DAP_AutoClock: %d %u %d\n",
+		DAP_Data.auto_clock.enable,
+		DAP_Data.auto_clock.clock,
+		DAP_Data.auto_clock.downshift
+	);
+
+	clock = DAP_Data.auto_clock.clock;
+	*(response + 0) = DAP_OK;
+	*(response + 1) = DAP_Data.auto_clock.enable;
+	*(response + 2) = (uint8_t)(clock >>  0);
+	*(response + 3) = (uint8_t)(clock >>  8);
+	*(response + 4) = (uint8_t)(clock >> 16);
+	*(response + 5) = (uint8_t)(clock >> 24);
+	*(response + 6) = (uint8_t)(DAP_Data.auto_clock.downshift >> 0);
+	*(response + 7) = (uint8_t)(DAP_Data.auto_clock.downshift >> 8);
+	return (8);
+}
+#endif
+
+
+// Process Attach command and prepare response
+//   Switch SWJ-DP to SWD, line reset, read IDCODE, clear sticky errors and
+//   power up debug and system domain (optional connect under reset).
+//   request:  pointer to request data
+//             options, power up timeout in ms (2)
+//   response: pointer to response data
+//   return:   number of bytes in response
+//             (status, ACK of last transfer, IDCODE (4), CTRL/STAT (4))
+#if (DAP_SWD != 0)
+// JTAG-to-SWD: line reset, 0xE79E, line reset, idle
+static const uint8_t DAP_AttachSequence[17] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0x9E, 0xE7,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0x00
+};
+
+static uint32_t DAP_Attach(uint8_t *request, uint8_t *response)
+{
+	uint32_t options;
+	uint32_t timeout;
+	uint32_t idcode;
+	uint32_t stat;
+	uint32_t data;
+	uint8_t  ack;
+
+	options = *(request + 0);
+	timeout = *(request + 1) | (*(request + 2) << 8);
+	idcode  = 0;
+	stat    = 0;
+
+	if (DAP_Data.debug_port != DAP_PORT_SWD)
+	{
+		DAP_Data.debug_port = DAP_PORT_SWD;
+		PORT_SWD_SETUP();
+	}
+	if (options & DAP_ATTACH_RESET)
+	{
+		PIN_nRESET_OUT(0);
+	}
+
+	SWJ_Sequence(sizeof(DAP_AttachSequence) * 8, (uint8_t *)DAP_AttachSequence);
+
+	ack = DP_Read(DP_IDCODE, &idcode);
+	if (ack != DAP_TRANSFER_OK) goto exit;
+	ack = DP_Write(DP_ABORT, ABORT_CLEAR);
+	if (ack != DAP_TRANSFER_OK) goto exit;
+	ack = DP_Write(DP_SELECT, 0);
+	if (ack != DAP_TRANSFER_OK) goto exit;
+	ack = DP_Write(DP_CTRL_STAT, CDBGPWRUPREQ | CSYSPWRUPREQ);
+	if (ack != DAP_TRANSFER_OK) goto exit;
+
+	// Wait for power up acknowledge
+	for (;;)
+	{
+		ack = DP_Read(DP_CTRL_STAT, &stat);
+		if (ack != DAP_TRANSFER_OK) goto exit;
+		if ((stat & (CDBGPWRUPACK | CSYSPWRUPACK)) == (CDBGPWRUPACK | CSYSPWRUPACK))
+			break;
+		if ((timeout == 0) || DAP_TransferAbort)
+		{
+			ack = DAP_TRANSFER_ERROR;
+			goto exit;
+		}
+		timeout--;
+		Delayms(1);
+	}
+
+	if ((options & (DAP_ATTACH_RESET | DAP_ATTACH_HALT)) == (DAP_ATTACH_RESET | DAP_ATTACH_HALT))
+	{	// Enable debug and catch reset vector
+		ack = MEM_AP_Setup();
+		if (ack != DAP_TRANSFER_OK) goto exit;
+		ack = MEM_AP_WriteWord(DBG_HCSR, DBGKEY | C_DEBUGEN | C_HALT);
+		if (ack != DAP_TRANSFER_OK) goto exit;
+		ack = MEM_AP_ReadWord(DBG_EMCR, &data);
+		if (ack != DAP_TRANSFER_OK) goto exit;
+		ack = MEM_AP_WriteWord(DBG_EMCR, data | VC_CORERESET);
+		if (ack != DAP_TRANSFER_OK) goto exit;
+	}
+
+exit:
+	if (options & DAP_ATTACH_RESET)
+	{
+		PIN_nRESET_OUT(1);
+	}
+
+	DEBUG("DAP_Attach: %02X %08X %08X\n", ack, idcode, stat);
+
+	*(response + 0)  = (ack == DAP_TRANSFER_OK) ? DAP_OK : DAP_ERROR;
+	*(response + 1)  = ack;
+	*(response + 2)  = (uint8_t)(idcode >>  0);
+	*(response + 3)  = (uint8_t)(idcode >>  8);
+	*(response + 4)  = (uint8_t)(idcode >> 16);
+	*(response + 5)  = (uint8_t)(idcode >> 24);
+	*(response + 6)  = (uint8_t)(stat   >>  0);
+	*(response + 7)  = (uint8_t)(stat   >>  8);
+	*(response + 8)  = (uint8_t)(stat   >> 16);
+	*(response + 9)  = (uint8_t)(stat   >> 24);
+	return (10);
+}
+#endif
+
+
+// Process Recovery command and prepare response
+//   request:  pointer to request data
+//             mode: 0 = disable, 1 = enable, 0xFF = read status only
+//   response: pointer to response data
+//   return:   number of bytes in response
+//             (status, enabled, total number of recoveries (2))
+#if ((DAP_SWD != 0) && (DAP_SWD_RECOVERY != 0))
+static uint32_t DAP_Recovery(uint8_t *request, uint8_t *response)
+{
+	if (*request != 0xFF)
+	{
+		DAP_Data.recovery.enable = (*request != 0) ? 1 : 0;
+		DAP_Data.recovery.count  = 0;
+		SWD_Select();
+	}
+
+	DEBUG("DAP_Recovery: %d %d\n",
+		DAP_Data.recovery.enable,
+		DAP_Data.recovery.count
+	);
+
+	*(response + 0) = DAP_OK;
+	*(response + 1) = DAP_Data.recovery.enable;
+	*(response + 2) = (uint8_t)(DAP_Data.recovery.count >> 0);
+	*(response + 3) = (uint8_t)(DAP_Data.recovery.count >> 8);
+	return (4);
+}
+#endif
+
+
+#if ((DAP_SWD != 0) && (DAP_SWD_GANG != 0))
+// Process Gang Setup command and prepare response
+//   request:  pointer to request data
+//             targets: bit mask of active targets (0 = gang mode off)
+//   response: pointer to response data
+//   return:   number of bytes in response
+//             (status, number of gang targets, active targets)
+static uint32_t DAP_GangSetup(uint8_t *request, uint8_t *response)
+{
+	// Restore SWD pin setup (TDI/TDO back to default mode)
+	DAP_Data.debug_port = DAP_PORT_SWD;
+	PORT_SWD_SETUP();
+	SWD_GangSetup(*request);
+
+	DEBUG("DAP_GangSetup: %02X\n", Gang_Active);
+
+	*(response + 0) = DAP_OK;
+	*(response + 1) = GANG_COUNT;
+	*(response + 2) = (uint8_t)Gang_Active;
+	return (3);
+}
+
+// Process Gang Sequence command and prepare response
+//   request:  pointer to request data
+//             sequence bit count (0 = 256), sequence bit data
+//   response: pointer to response data
+//   return:   number of bytes in response
+static uint32_t DAP_GangSequence(uint8_t *request, uint8_t *response)
+{
+	uint32_t count;
+
+	if (Gang_Active == 0)
+	{
+		*response = DAP_ERROR;
+		return (1);
+	}
+
+	count = *request++;
+	if (count == 0)
+		count = 256;
+	SWD_GangSequence(count, request);
+
+	*response = DAP_OK;
+	return (1);
+}
+
+// Process Gang Transfer command and prepare response
+//   Every transfer is broadcast to all active targets. Transfers are retried
+//   on the targets with WAIT response (up to the WAIT retry count), targets
+//   without OK response are removed from the active targets.
+//   request:  pointer to request data
+//             transfer count, then per transfer: request, write data (4)
+//   response: pointer to response data
+//   return:   number of bytes in response
+//             (transfers done, active targets,
+//              per transfer: ACK of each target, read data of each target (4))
+static uint32_t DAP_GangTransfer(uint8_t *request, uint8_t *response)
+{
+	uint8_t  *response_count;
+	uint8_t  *response_active;
+	uint32_t  response_size;
+	uint32_t  request_count;
+	uint32_t  request_value;
+	uint32_t  data[GANG_COUNT];
+	uint8_t   ack[GANG_COUNT];
+	uint32_t  retry;
+	uint32_t  ok, wait;
+	uint32_t  n, k;
+
+	response_count  = response++;
+	response_active = response++;
+	response_size   = 1 + 2;
+	n = 0;
+
+	request_count = *request++;
+	for (; Gang_Active && (n < request_count); n++)
+	{
+		request_value = *request++;
+		if (request_value & DAP_TRANSFER_RnW)
+		{
+			if ((response_size + GANG_COUNT * (1 + 4)) > DAP_PACKET_SIZE)
+				break;
+		}
+		else
+		{
+			if ((response_size + GANG_COUNT) > DAP_PACKET_SIZE)
+				break;
+			data[0] = (*(request+0) <<  0) |
+					  (*(request+1) <<  8) |
+					  (*(request+2) << 16) |
+					  (*(request+3) << 24);
+			request += 4;
+		}
+
+		for (k = 0; k < GANG_COUNT; k++)
+		{
+			ack[k] = 0;
+		}
+		retry = DAP_Data.transfer.retry_count;
+		ok = 0;
+		for (;;)
+		{
+			ok |= SWD_GangTransfer(request_value, data, ack);
+			wait = 0;
+			for (k = 0; k < GANG_COUNT; k++)
+			{
+				if ((Gang_Select & (1 << k)) && (ack[k] == DAP_TRANSFER_WAIT))
+					wait |= 1 << k;
+			}
+			if ((wait == 0) || (retry-- == 0) || DAP_TransferAbort)
+				break;
+			if (wait != Gang_Select)
+			{	// Retry only the waiting targets
+				SWD_GangSelect(wait);
+			}
+		}
+		if (Gang_Select != Gang_Active)
+		{
+			SWD_GangSelect(Gang_Active);
+		}
+		if (ok != Gang_Active)
+		{	// Remove failed targets
+			SWD_GangSetup(ok);
+		}
+
+		for (k = 0; k < GANG_COUNT; k++)
+		{
+			*response++ = ack[k];
+		}
+		response_size += GANG_COUNT;
+		if (request_value & DAP_TRANSFER_RnW)
+		{
+			for (k = 0; k < GANG_COUNT; k++)
+			{
+				if ((ok & (1 << k)) == 0)
+					data[k] = 0;
+				*response++ = (uint8_t)(data[k] >>  0);
+				*response++ = (uint8_t)(data[k] >>  8);
+				*response++ = (uint8_t)(data[k] >> 16);
+				*response++ = (uint8_t)(data[k] >> 24);
+			}
+			response_size += GANG_COUNT * 4;
+		}
+	}
+
+	DEBUG("DAP_GangTransfer: %d %02X\n", n, Gang_Active);
+
+	*response_count  = (uint8_t)n;
+	*response_active = (uint8_t)Gang_Active;
+	return (response_size - 1);
+}
+#endif
+
+// Process Monitor command and prepare response
+//   request:  pointer to request data
+//             mode: 0 = disable, 1 = enable, 0xFF = read status only
+//             monitor period in ms (2, 0 = default)
+//   response: pointer to response data
+//   return:   number of bytes in response
+//             (status, enabled, number of events (2), last DHCSR (4))
+//   Event report (unsolicited): ID_DAP_Monitor, DAP_MONITOR_EVENT, DHCSR (4)
+#if ((DAP_SWD != 0) && (DAP_SWD_MONITOR != 0))
+static uint32_t DAP_Monitor(uint8_t *request, uint8_t *response)
+{
+	if (*request != 0xFF)
+	{
+		Monitor_Setup((*request != 0) ? 1 : 0, *(request + 1) | (*(request + 2) << 8));
+	}
+
+	DEBUG("DAP_Monitor: %d %d %08X\n", Monitor.enable, Monitor.events, Monitor.dhcsr);
+
+	*(response + 0) = DAP_OK;
+	*(response + 1) = Monitor.enable;
+	*(response + 2) = (uint8_t)(Monitor.events >>  0);
+	*(response + 3) = (uint8_t)(Monitor.events >>  8);
+	*(response + 4) = (uint8_t)(Monitor.dhcsr  >>  0);
+	*(response + 5) = (uint8_t)(Monitor.dhcsr  >>  8);
+	*(response + 6) = (uint8_t)(Monitor.dhcsr  >> 16);
+	*(response + 7) = (uint8_t)(Monitor.dhcsr  >> 24);
+	return (8);
+}
+#endif
+
+
+// Process Condition command and prepare response
+//   request:  pointer to request data
+//             index, operator (0 = off), FPB comparator, breakpoint address (4),
+//             register number or memory address (4), mask (4), value (4),
+//             count of true hits per report (2)
+//   response: pointer to response data
+//   return:   number of bytes in response
+//             (status, number of halts resumed by the probe (2))
+#if ((DAP_SWD != 0) && (DAP_SWD_MONITOR != 0) && (DAP_SWD_CONDITION != 0))
+static uint32_t DAP_Condition(uint8_t *request, uint8_t *response)
+{
+	uint32_t n;
+
+	n = *request++;
+	if (n >= CONDITION_COUNT)
+	{
+		*response = DAP_ERROR;
+		return (1);
+	}
+
+	Condition[n].op       = *(request + 0);
+	Condition[n].comp     = *(request + 1);
+	request += 2;
+	Condition[n].address  = (*(request+0) << 0) | (*(request+1) << 8) | (*(request+2) << 16) | (*(request+3) << 24);
+	request += 4;
+	Condition[n].operand  = (*(request+0) << 0) | (*(request+1) << 8) | (*(request+2) << 16) | (*(request+3) << 24);
+	request += 4;
+	Condition[n].mask     = (*(request+0) << 0) | (*(request+1) << 8) | (*(request+2) << 16) | (*(request+3) << 24);
+	request += 4;
+	Condition[n].value    = (*(request+0) << 0) | (*(request+1) << 8) | (*(request+2) << 16) | (*(request+3) << 24);
+	request += 4;
+	Condition[n].count    = *(request + 0) | (*(request + 1) << 8);
+	Condition[n].hits     = 0;
+
+	DEBUG("DAP_Condition: %d %02X %08X %d\n", n, Condition[n].op, Condition[n].address, Condition[n].skipped);
+
+	*(response + 0) = DAP_OK;
+	*(response + 1) = (uint8_t)(Condition[n].skipped >> 0);
+	*(response + 2) = (uint8_t)(Condition[n].skipped >> 8);
+	Condition[n].skipped = 0;
+	return (3);
+}
+#endif
+
+
+#if ((DAP_SWD != 0) && (DAP_SWD_MONITOR != 0) && (DAP_SWD_TRACEPOINT != 0))
+// Process Tracepoint command and prepare response
+//   request:  pointer to request data
+//             index, enable, FPB comparator, breakpoint address (4),
+//             core registers (4, bit n = DCRSR REGSEL n), number of memory ranges,
+//             per memory range: address (4), number of words
+//   response: pointer to response data
+//   return:   number of bytes in response (status)
+static uint32_t DAP_Tracepoint(uint8_t *request, uint8_t *response)
+{
+	uint32_t enable;
+	uint32_t n, i;
+
+	n = *request++;
+	enable = *(request + 0);
+	if ((n >= TRACEPOINT_COUNT) || (*(request + 10) > TRACE_RANGES))
+	{
+		*response = DAP_ERROR;
+		return (1);
+	}
+
+	Tracepoint[n].enable  = 0;
+	Tracepoint[n].comp    = *(request + 1);
+	Tracepoint[n].address = (*(request+2) << 0) | (*(request+3) << 8) | (*(request+4) << 16) | (*(request+5) << 24);
+	Tracepoint[n].regs    = (*(request+6) << 0) | (*(request+7) << 8) | (*(request+8) << 16) | (*(request+9) << 24);
+	Tracepoint[n].ranges  = *(request + 10);
+	for (i = 0; i < Tracepoint[n].ranges; i++)
+	{
+		Tracepoint[n].mem_addr[i]  = (*(request+11) << 0) | (*(request+12) << 8) | (*(request+13) << 16) | (*(request+14) << 24);
+		Tracepoint[n].mem_words[i] = *(request + 15);
+		if (Tracepoint[n].mem_words[i] > TRACE_WORDS)
+		{
+			*response = DAP_ERROR;
+			return (1);
+		}
+		request += 5;
+	}
+	Tracepoint[n].enable  = (enable != 0) ? 1 : 0;
+
+	DEBUG("DAP_Tracepoint: %d %d %08X %08X\n", n, Tracepoint[n].enable, Tracepoint[n].address, Tracepoint[n].regs);
+
+	*response = DAP_OK;
+	return (1);
+}
+
+// Process Trace Read command and prepare response
+//   request:  pointer to request data (none)
+//   response: pointer to response data
+//   return:   number of bytes in response
+//             (status, records lost (2), number of bytes, trace data)
+static uint32_t DAP_TraceRead(uint8_t *request, uint8_t *response)
+{
+	uint32_t n;
+
+	*(response + 0) = DAP_OK;
+	*(response + 1) = (uint8_t)(Trace_Lost >> 0);
+	*(response + 2) = (uint8_t)(Trace_Lost >> 8);
+	Trace_Lost = 0;
+
+	for (n = 0; (n < (DAP_PACKET_SIZE - 5)) && (Trace_Out != Trace_In); n++)
+	{
+		*(response + 4 + n) = Trace_Buffer[Trace_Out];
+		if (++Trace_Out == TRACE_BUFFER_SIZE)
+			Trace_Out = 0;
+	}
+	*(response + 3) = (uint8_t)n;
+	return (4 + n);
+}
+#endif
+
+
+#if ((DAP_SWD != 0) && (DAP_SWD_MONITOR != 0) && (DAP_SWD_PROFILE != 0))
+// Process Profile command and prepare response
+//   request:  pointer to request data
+//             mode: 0 = stop, 1 = start, 0xFF = read status only
+//             base address (4), bin size (log2 bytes)
+//   response: pointer to response data
+//   return:   number of bytes in response
+//             (status, running, samples (4), samples outside (4), samples halted (4))
+static uint32_t DAP_Profile(uint8_t *request, uint8_t *response)
+{
+	if (*request != 0xFF)
+	{
+		Profile_Setup(
+			(*request != 0) ? 1 : 0,
+			(*(request+1) << 0) | (*(request+2) << 8) | (*(request+3) << 16) | (*(request+4) << 24),
+			*(request + 5) & 0x1F
+		);
+	}
+
+	DEBUG("DAP_Profile: %d %u\n", Profile.enable, Profile.samples);
+
+	*(response +  0) = DAP_OK;
+	*(response +  1) = Profile.enable;
+	*(response +  2) = (uint8_t)(Profile.samples >>  0);
+	*(response +  3) = (uint8_t)(Profile.samples >>  8);
+	*(response +  4) = (uint8_t)(Profile.samples >> 16);
+	*(response +  5) = (uint8_t)(Profile.samples >> 24);
+	*(response +  6) = (uint8_t)(Profile.outside >>  0);
+	*(response +  7) = (uint8_t)(Profile.outside >>  8);
+	*(response +  8) = (uint8_t)(Profile.outside >> 16);
+	*(response +  9) = (uint8_t)(Profile.outside >> 24);
+	*(response + 10) = (uint8_t)(Profile.halted  >>  0);
+	*(response + 11) = (uint8_t)(Profile.halted  >>  8);
+	*(response + 12) = (uint8_t)(Profile.halted  >> 16);
+	*(response + 13) = (uint8_t)(Profile.halted  >> 24);
+	return (14);
+}
+
+// Process Profile Read command and prepare response
+//   request:  pointer to request data
+//             first bin (2), number of bins
+//   response: pointer to response data
+//   return:   number of bytes in response
+//             (status, number of bins, bin counts (2 each))
+static uint32_t DAP_ProfileRead(uint8_t *request, uint8_t *response)
+{
+	uint32_t bin;
+	uint32_t count;
+	uint32_t n;
+
+	bin   = *(request + 0) | (*(request + 1) << 8);
+	count = *(request + 2);
+	if (count > ((DAP_PACKET_SIZE - 3) / 2))
+		count = (DAP_PACKET_SIZE - 3) / 2;
+	if (bin >= PROFILE_BINS)
+		count = 0;
+	else if (count > (PROFILE_BINS - bin))
+		count = PROFILE_BINS - bin;
+
+	*(response + 0) = DAP_OK;
+	*(response + 1) = (uint8_t)count;
+	response += 2;
+	for (n = 0; n < count; n++)
+	{
+		*response++ = (uint8_t)(Profile_Bins[bin + n] >> 0);
+		*response++ = (uint8_t)(Profile_Bins[bin + n] >> 8);
+	}
+	return (2 + 2 * count);
+}
+#endif
+
+
+#if ((DAP_SWD != 0) && (DAP_SWD_MONITOR != 0) && (DAP_SWD_SAMPLE != 0))
+// Process Sample command and prepare response
+//   request:  pointer to request data
+//             mode: 0 = stop, 1 = start, 0xFF = read status only
+//             sample period in us (4), number of items,
+//             per item: word aligned address (4), number of words
+//   response: pointer to response data
+//   return:   number of bytes in response
+//             (status, running, words per sample, samples lost (2), periods missed (2))
+static uint32_t DAP_Sample(uint8_t *request, uint8_t *response)
+{
+	uint32_t mode;
+	uint32_t period;
+	uint32_t status;
+	uint32_t n;
+
+	mode   = *(request + 0);
+	period = (*(request+1) << 0) | (*(request+2) << 8) | (*(request+3) << 16) | (*(request+4) << 24);
+	status = DAP_OK;
+
+	if (mode != 0xFF)
+	{
+		Sample.enable = 0;
+		if (mode != 0)
+		{
+			Sample.items = *(request + 5);
+			request += 6;
+			if ((Sample.items > SAMPLE_ITEMS) ||
+				((Sample.items * 5 + 6) > (DAP_PACKET_SIZE - 1)))
+				Sample.items = 0;	// Item list exceeds table or request
+			for (n = 0; n < Sample.items; n++)
+			{
+				Sample_Item[n].addr  = ((*(request+0) << 0) | (*(request+1) << 8) | (*(request+2) << 16) | (*(request+3) << 24)) & ~3;
+				Sample_Item[n].words = *(request + 4);
+				request += 5;
+			}
+		}
+		if (Sample_Setup(mode, period))
+			status = DAP_ERROR;
+	}
+
+	DEBUG("DAP_Sample: %d %d %d\n", Sample.enable, Sample.lost, Sample.missed);
+
+	*(response + 0) = status;
+	*(response + 1) = Sample.enable;
+	*(response + 2) = Sample.words;
+	*(response + 3) = (uint8_t)(Sample.lost   >> 0);
+	*(response + 4) = (uint8_t)(Sample.lost   >> 8);
+	*(response + 5) = (uint8_t)(Sample.missed >> 0);
+	*(response + 6) = (uint8_t)(Sample.missed >> 8);
+	return (7);
+}
+
+// Process Sample Read command and prepare response
+//   request:  pointer to request data (none)
+//   response: pointer to response data
+//   return:   number of bytes in response
+//             (status, number of bytes, sample data)
+static uint32_t DAP_SampleRead(uint8_t *request, uint8_t *response)
+{
+	uint32_t n;
+
+	for (n = 0; (n < (DAP_PACKET_SIZE - 3)) && (Sample_Out != Sample_In); n++)
+	{
+		*(response + 2 + n) = Sample_Buffer[Sample_Out];
+		if (++Sample_Out == SAMPLE_BUFFER_SIZE)
+			Sample_Out = 0;
+	}
+	*(response + 0) = DAP_OK;
+	*(response + 1) = (uint8_t)n;
+	return (2 + n);
+}
+#endif
+
+
+// Process RTT command and prepare response
+//   request:  pointer to request data
+//             mode: 0 = stop, 1 = control block at address, 2 = scan, 0xFF = read status only
+//             address (4), scan size in bytes (4), up-buffer index, down-buffer index
+//   response: pointer to response data
+//   return:   number of bytes in response
+//             (status, state, control block address (4), bytes sent to COM port (4))
+#if ((DAP_SWD != 0) && (DAP_SWD_MONITOR != 0) && (DAP_SWD_RTT != 0))
+static uint32_t DAP_Rtt(uint8_t *request, uint8_t *response)
+{
+	if (*request != 0xFF)
+	{
+		Rtt_Setup(
+			*(request + 0),
+			(*(request+1) << 0) | (*(request+2) << 8) | (*(request+3) << 16) | (*(request+4) << 24),
+			(*(request+5) << 0) | (*(request+6) << 8) | (*(request+7) << 16) | (*(request+8) << 24),
+			*(request + 9),
+			*(request + 10)
+		);
+	}
+
+	DEBUG("DAP_Rtt: %d %08X %u\n", Rtt.state, Rtt.addr, Rtt.up_bytes);
+
+	*(response + 0) = ((*request != 0) && (Rtt.state == RTT_OFF)) ? DAP_ERROR : DAP_OK;
+	*(response + 1) = Rtt.state;
+	*(response + 2) = (uint8_t)(Rtt.addr     >>  0);
+	*(response + 3) = (uint8_t)(Rtt.addr     >>  8);
+	*(response + 4) = (uint8_t)(Rtt.addr     >> 16);
+	*(response + 5) = (uint8_t)(Rtt.addr     >> 24);
+	*(response + 6) = (uint8_t)(Rtt.up_bytes >>  0);
+	*(response + 7) = (uint8_t)(Rtt.up_bytes >>  8);
+	*(response + 8) = (uint8_t)(Rtt.up_bytes >> 16);
+	*(response + 9) = (uint8_t)(Rtt.up_bytes >> 24);
+	return (10);
+}
+#endif
+
+
+// Process Semihost command and prepare response
+//   request:  pointer to request data
+//             mode: 0 = disable, 1 = enable, 0xFF = read status only
+//   response: pointer to response data
+//   return:   number of bytes in response
+//             (status, enabled, operations passed to host (2), bytes sent to COM port (4))
+#if ((DAP_SWD != 0) && (DAP_SWD_MONITOR != 0) && (DAP_SWD_SEMIHOST != 0))
+static uint32_t DAP_Semihost(uint8_t *request, uint8_t *response)
+{
+	uint32_t status;
+
+	status = DAP_OK;
+	if (*request != 0xFF)
+	{
+		if (Semihost.pending)
+		{	// Halt of the operation in progress is reported by the monitor
+			Semihost.pending = 0;
+			Monitor.valid = 0;
+		}
+		Semihost_TextCount = 0;
+		Semihost.enable = 0;
+		Semihost.host   = 0;
+		Semihost.bytes  = 0;
+		if (*request != 0)
+		{
+			if (pCoreDescriptor->CdcWrite == NULL)
+				status = DAP_ERROR;
+			else
+				Semihost.enable = 1;
+		}
+	}
+
+	DEBUG("DAP_Semihost: %d %d %u\n", Semihost.enable, Semihost.host, Semihost.bytes);
+
+	*(response + 0) = status;
+	*(response + 1) = Semihost.enable;
+	*(response + 2) = (uint8_t)(Semihost.host  >>  0);
+	*(response + 3) = (uint8_t)(Semihost.host  >>  8);
+	*(response + 4) = (uint8_t)(Semihost.bytes >>  0);
+	*(response + 5) = (uint8_t)(Semihost.bytes >>  8);
+	*(response + 6) = (uint8_t)(Semihost.bytes >> 16);
+	*(response + 7) = (uint8_t)(Semihost.bytes >> 24);
+	return (8);
+}
+#endif
+
+
+// Process DAP Vendor idle time and prepare unsolicited report
+//   Each step has bounded SWD traffic (PROFILE_BURST, SAMPLE_WORDS, RTT_CHUNK,
+//   SEMIHOST_CHUNK), the steps after a USB request arrived are skipped.
+//   report:   pointer to report data
+//   return:   number of bytes in report (0 = no report)
+uint32_t DAP_ProcessVendorIdle(uint8_t *report)
+{
+#if ((DAP_SWD != 0) && (DAP_SWD_MONITOR != 0))
+	uint32_t dhcsr;
+
+#if (DAP_SWD_PROFILE != 0)
+	Profile_Idle();
+#endif
+#if (DAP_SWD_SAMPLE != 0)
+	if (Monitor_Preempt())
+		return (0);
+	Sample_Idle();
+#endif
+#if (DAP_SWD_RTT != 0)
+	if (Monitor_Preempt())
+		return (0);
+	Rtt_Idle();
+#endif
+#if (DAP_SWD_SEMIHOST != 0)
+	if (Monitor_Preempt())
+		return (0);
+	if (Semihost.enable)
+		Semihost_Idle();
+#endif
+
+	if (Monitor_Preempt())
+		return (0);
+	if (Monitor_Poll(&dhcsr))
+	{
+		DEBUG("DAP_MonitorEvent: %08X\n", dhcsr);
+		*(report + 0) = ID_DAP_Monitor;
+		*(report + 1) = DAP_MONITOR_EVENT;
+		*(report + 2) = (uint8_t)(dhcsr >>  0);
+		*(report + 3) = (uint8_t)(dhcsr >>  8);
+		*(report + 4) = (uint8_t)(dhcsr >> 16);
+		*(report + 5) = (uint8_t)(dhcsr >> 24);
+		return (6);
+	}
+#endif
+	return (0);
+}
+
+
+// Check for DAP Vendor idle work that must not wait for the next interrupt
+//   (sampler, profiler, RTT bridge, probe handled halts, semihosting output)
+//   return:   1 = idle work pending, 0 = idle time can be spent sleeping
+uint32_t DAP_ProcessVendorBusy(void)
+{
+#if ((DAP_SWD != 0) && (DAP_SWD_MONITOR != 0))
+	if (DAP_Data.debug_port != DAP_PORT_SWD)
+		return (0);
+#if (DAP_SWD_PROFILE != 0)
+	if (Profile.enable)
+		return (1);
+#endif
+#if (DAP_SWD_SAMPLE != 0)
+	if (Sample.enable)
+		return (1);
+#endif
+#if (DAP_SWD_RTT != 0)
+	if ((Rtt.state == RTT_SCAN) || (Rtt.state == RTT_RUN))
+		return (1);
+#endif
+#if (DAP_SWD_SEMIHOST != 0)
+	if (Semihost.pending || (Semihost_TextSent < Semihost_TextCount))
+		return (1);
+#endif
+	if (Monitor.enable && Monitor_Fast())
+		return (1);
+#endif
+	return (0);
+}
+
+
+// Process DAP Vendor command and prepare response
+//   request:  pointer to request data
+//   response: pointer to response data
+//   return:   number of bytes in response
+uint32_t DAP_ProcessVendorCommand(uint8_t *request, uint8_t *response)
+{
+	uint32_t num;
+
+	*response++ = *request;
+
+	switch (*request++)
+	{
+#if ((DAP_SWD != 0) && (DAP_SWD_AUTO_CLOCK != 0))
+		case ID_DAP_AutoClock:
+			num = DAP_AutoClock(request, response);
+			break;
+#endif
+#if (DAP_SWD != 0)
+		case ID_DAP_Attach:
+			num = DAP_Attach(request, response);
+			break;
+#endif
+#if ((DAP_SWD != 0) && (DAP_SWD_RECOVERY != 0))
+		case ID_DAP_Recovery:
+			num = DAP_Recovery(request, response);
+			break;
+#endif
+#if ((DAP_SWD != 0) && (DAP_SWD_GANG != 0))
+		case ID_DAP_GangSetup:
+			num = DAP_GangSetup(request, response);
+			break;
+		case ID_DAP_GangSequence:
+			num = DAP_GangSequence(request, response);
+			break;
+		case ID_DAP_GangTransfer:
+			num = DAP_GangTransfer(request, response);
+			break;
+#endif
+#if ((DAP_SWD != 0) && (DAP_SWD_MONITOR != 0))
+		case ID_DAP_Monitor:
+			num = DAP_Monitor(request, response);
+			break;
+#endif
+#if ((DAP_SWD != 0) && (DAP_SWD_MONITOR != 0) && (DAP_SWD_CONDITION != 0))
+		case ID_DAP_Condition:
+			num = DAP_Condition(request, response);
+			break;
+#endif
+#if ((DAP_SWD != 0) && (DAP_SWD_MONITOR != 0) && (DAP_SWD_TRACEPOINT != 0))
+		case ID_DAP_Tracepoint:
+			num = DAP_Tracepoint(request, response);
+			break;
+		case ID_DAP_TraceRead:
+			num = DAP_TraceRead(request, response);
+			break;
+#endif
+#if ((DAP_SWD != 0) && (DAP_SWD_MONITOR != 0) && (DAP_SWD_PROFILE != 0))
+		case ID_DAP_Profile:
+			num = DAP_Profile(request, response);
+			break;
+		case ID_DAP_ProfileRead:
+			num = DAP_ProfileRead(request, response);
+			break;
+#endif
+#if ((DAP_SWD != 0) && (DAP_SWD_MONITOR != 0) && (DAP_SWD_SAMPLE != 0))
+		case ID_DAP_Sample:
+			num = DAP_Sample(request, response);
+			break;
+		case ID_DAP_SampleRead:
+			num = DAP_SampleRead(request, response);
+			break;
+#endif
+#if ((DAP_SWD != 0) && (DAP_SWD_MONITOR != 0) && (DAP_SWD_RTT != 0))
+		case ID_DAP_Rtt:
+			num = DAP_Rtt(request, response);
+			break;
+#endif
+#if ((DAP_SWD != 0) && (DAP_SWD_MONITOR != 0) && (DAP_SWD_SEMIHOST != 0))
+		case ID_DAP_Semihost:
+			num = DAP_Semihost(request, response);
+			break;
+#endif
+
+		default:
+			*(response - 1) = ID_DAP_Invalid;
+			return (1);
+	}
+
+	return (1 + num);
+}
+
+#endif	/* (DAP_VENDOR_COMMANDS != 0) */
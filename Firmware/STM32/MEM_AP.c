@@ -0,0 +1,248 @@
+/******************************************************************************
+ * @file	MEM_AP.c
+ * @brief	CMSIS-DAP SW-DP and MEM-AP access for probe side commands
+ *
+ * The functions use SWD_Transfer with WAIT retries (DAP_Data.transfer.retry_count)
+ * and access the MEM-AP with APSEL 0 and 32-bit single transfers.
+ ******************************************************************************/
+
+#include "DAP_config.h"
+#include "..\DAP.h"
+
+#if ((DAP_SWD != 0) && (DAP_VENDOR_COMMANDS != 0))
+
+// DP CTRL/STAT bits
+#define CSYSPWRUPACK		0x80000000
+#define CSYSPWRUPREQ		0x40000000
+#define CDBGPWRUPACK		0x20000000
+#define CDBGPWRUPREQ		0x10000000
+#define WDATAERR			0x00000080
+#define STICKYERR			0x00000020
+#define STICKYCMP			0x00000010
+#define STICKYORUN			0x00000002
+#define STICKY_FLAGS		(WDATAERR | STICKYERR | STICKYCMP | STICKYORUN)
+
+// DP ABORT bits
+#define ORUNERRCLR			0x00000010
+#define WDERRCLR			0x00000008
+#define STKERRCLR			0x00000004
+#define STKCMPCLR			0x00000002
+#define ABORT_CLEAR			(ORUNERRCLR | WDERRCLR | STKERRCLR | STKCMPCLR)
+
+// MEM-AP registers (bank 0)
+#define AP_CSW				0x00
+#define AP_TAR				0x04
+#define AP_DRW				0x0C
+
+// MEM-AP CSW: DbgSwEnable, HPROT Privileged/Data, no Auto Increment, 32-bit
+#define CSW_VALUE			0x23000002
+#define CSW_ADDRINC			0x00000010		// Auto Increment single
+#define CSW_BYTE			0x23000000		// 8-bit transfers
+
+// TAR auto increment is limited to 1kB blocks
+#define TAR_BLOCK			0x400
+
+// Cortex-M Debug registers
+#define DBG_HCSR			0xE000EDF0		// Debug Halting Control and Status
+#define DBG_CRSR			0xE000EDF4		// Debug Core Register Selector
+#define DBG_CRDR			0xE000EDF8		// Debug Core Register Data
+#define DBG_EMCR			0xE000EDFC		// Debug Exception and Monitor Control
+#define DBG_DFSR			0xE000ED30		// Debug Fault Status
+
+// DFSR bits
+#define DFSR_HALTED			0x00000001
+#define DFSR_BKPT			0x00000002
+
+// Flash Patch and Breakpoint unit
+#define FP_CTRL				0xE0002000
+#define FP_COMP(n)			(0xE0002008 + ((n) << 2))
+#define FP_COMP_ENABLE		0x00000001
+
+// DHCSR bits
+#define DBGKEY				0xA05F0000
+#define C_DEBUGEN			0x00000001
+#define C_HALT				0x00000002
+#define C_STEP				0x00000004
+#define C_MASKINTS			0x00000008
+#define S_REGRDY			0x00010000
+#define S_HALT				0x00020000
+#define S_SLEEP				0x00040000
+#define S_LOCKUP			0x00080000
+#define S_RETIRE_ST			0x01000000
+#define S_RESET_ST			0x02000000
+
+// DCRSR bits
+#define DCRSR_REGWnR		0x00010000
+
+// DEMCR bits
+#define VC_CORERESET		0x00000001
+#define TRCENA				0x01000000
+
+
+// SWD Transfer with WAIT retries
+//	request: A[3:2] RnW APnDP
+//	data:	DATA[31:0]
+//	return:  ACK[2:0]
+static uint8_t SWD_TransferRetry(uint32_t request, uint32_t *data)
+{
+	uint32_t retry;
+	uint8_t  ack;
+
+	retry = DAP_Data.transfer.retry_count;
+	do
+	{
+		ack = SWD_Transfer(request, data);
+	} while ((ack == DAP_TRANSFER_WAIT) && retry-- && !DAP_TransferAbort);
+	return (ack);
+}
+
+// Read DP register
+//	reg:	DP register address (0x00 .. 0x0C)
+//	data:	pointer to register value
+//	return:	ACK[2:0]
+static uint8_t DP_Read(uint32_t reg, uint32_t *data)
+{
+	return (SWD_TransferRetry((reg & 0x0C) | DAP_TRANSFER_RnW, data));
+}
+
+// Write DP register
+//	reg:	DP register address (0x00 .. 0x0C)
+//	data:	register value
+//	return:	ACK[2:0]
+static uint8_t DP_Write(uint32_t reg, uint32_t data)
+{
+	uint8_t ack;
+
+	ack = SWD_TransferRetry(reg & 0x0C, &data);
+#if (DAP_SWD_SELECT != 0)
+	if ((ack == DAP_TRANSFER_OK) && ((reg & 0x0C) == DP_SELECT))
+		SWD_SelectWritten(data);
+#endif
+	return (ack);
+}
+
+// Write AP register of selected AP bank
+//	reg:	AP register address (0x00 .. 0x0C)
+//	data:	register value
+//	return:	ACK[2:0]
+static uint8_t AP_Write(uint32_t reg, uint32_t data)
+{
+	return (SWD_TransferRetry((reg & 0x0C) | DAP_TRANSFER_APnDP, &data));
+}
+
+// Read AP register of selected AP bank (posted read + RDBUFF)
+//	reg:	AP register address (0x00 .. 0x0C)
+//	data:	pointer to register value
+//	return:	ACK[2:0]
+static uint8_t AP_Read(uint32_t reg, uint32_t *data)
+{
+	uint8_t ack;
+
+	ack = SWD_TransferRetry((reg & 0x0C) | DAP_TRANSFER_APnDP | DAP_TRANSFER_RnW, NULL);
+	if (ack != DAP_TRANSFER_OK)
+		return (ack);
+	return (DP_Read(DP_RDBUFF, data));
+}
+
+// Select MEM-AP 0 bank 0 and setup CSW for 32-bit single transfers
+//	return:	ACK[2:0]
+static uint8_t MEM_AP_Setup(void)
+{
+	uint8_t ack;
+
+	ack = DP_Write(DP_SELECT, 0);
+	if (ack != DAP_TRANSFER_OK)
+		return (ack);
+	return (AP_Write(AP_CSW, CSW_VALUE));
+}
+
+// Read 32-bit word from target memory
+//	addr:	word aligned address
+//	data:	pointer to value
+//	return:	ACK[2:0]
+static uint8_t MEM_AP_ReadWord(uint32_t addr, uint32_t *data)
+{
+	uint8_t ack;
+
+	ack = AP_Write(AP_TAR, addr);
+	if (ack != DAP_TRANSFER_OK)
+		return (ack);
+	return (AP_Read(AP_DRW, data));
+}
+
+// Write 32-bit word to target memory
+//	addr:	word aligned address
+//	data:	value
+//	return:	ACK[2:0]
+static uint8_t MEM_AP_WriteWord(uint32_t addr, uint32_t data)
+{
+	uint8_t ack;
+
+	ack = AP_Write(AP_TAR, addr);
+	if (ack != DAP_TRANSFER_OK)
+		return (ack);
+	return (AP_Write(AP_DRW, data));
+}
+
+// Read block of 32-bit words from target memory (TAR auto increment)
+//	addr:	word aligned address
+//	data:	pointer to values
+//	count:	number of words
+//	return:	ACK[2:0]
+static uint8_t MEM_AP_ReadBlock(uint32_t addr, uint32_t *data, uint32_t count)
+{
+	uint32_t n;
+	uint8_t  ack;
+
+	ack = AP_Write(AP_CSW, CSW_VALUE | CSW_ADDRINC);
+	while ((ack == DAP_TRANSFER_OK) && count)
+	{
+		n = (TAR_BLOCK - (addr & (TAR_BLOCK - 1))) >> 2;
+		if (n > count)
+			n = count;
+		addr  += n << 2;
+		count -= n;
+
+		ack = AP_Write(AP_TAR, addr - (n << 2));
+		if (ack != DAP_TRANSFER_OK)
+			break;
+		// Post first read, every next read returns previous data
+		ack = SWD_TransferRetry(AP_DRW | DAP_TRANSFER_APnDP | DAP_TRANSFER_RnW, NULL);
+		while ((ack == DAP_TRANSFER_OK) && --n)
+		{
+			ack = SWD_TransferRetry(AP_DRW | DAP_TRANSFER_APnDP | DAP_TRANSFER_RnW, data++);
+		}
+		if (ack == DAP_TRANSFER_OK)
+			ack = DP_Read(DP_RDBUFF, data++);
+	}
+	if (ack == DAP_TRANSFER_OK)
+		ack = AP_Write(AP_CSW, CSW_VALUE);
+	return (ack);
+}
+
+// Write bytes to target memory (TAR auto increment)
+//	addr:	address
+//	data:	pointer to bytes
+//	count:	number of bytes
+//	return:	ACK[2:0]
+static uint8_t MEM_AP_WriteBytes(uint32_t addr, uint8_t *data, uint32_t count)
+{
+	uint8_t ack;
+
+	ack = AP_Write(AP_CSW, CSW_BYTE | CSW_ADDRINC);
+	if (ack == DAP_TRANSFER_OK)
+		ack = AP_Write(AP_TAR, addr);
+	while ((ack == DAP_TRANSFER_OK) && count--)
+	{
+		if ((addr & (TAR_BLOCK - 1)) == 0)
+			ack = AP_Write(AP_TAR, addr);	// Next 1kB block
+		if (ack == DAP_TRANSFER_OK)
+			ack = AP_Write(AP_DRW, (uint32_t)(*data++) << ((addr & 3) << 3));
+		addr++;
+	}
+	if (ack == DAP_TRANSFER_OK)
+		ack = AP_Write(AP_CSW, CSW_VALUE);
+	return (ack);
+}
+
+#endif	/* ((DAP_SWD != 0) && (DAP_VENDOR_COMMANDS != 0)) */
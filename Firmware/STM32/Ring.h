@@ -0,0 +1,66 @@
+/******************************************************************************
+ * @file	Ring.h
+ * @brief	Single-producer/single-consumer ring buffer indices
+ *
+ * The producer (interrupt or main loop) only advances the in index, the
+ * consumer only advances the out index. Both are free running 32-bit counters:
+ * the number of used slots is in - out and the slot of an index is
+ * index & (size - 1), so the ring size must be 2^n and a full ring needs no
+ * extra flag. The data memory barrier orders slot access against the index
+ * update seen by the other side.
+ *
+ * Producer:	if (Ring_Free(&r, SIZE)) { data[RING_SLOT(r.in,  SIZE)] = x; Ring_Put(&r, 1); }
+ * Consumer:	if (Ring_Count(&r))      { x = data[RING_SLOT(r.out, SIZE)]; Ring_Get(&r, 1); }
+ ******************************************************************************/
+
+#ifndef __RING_H__
+#define __RING_H__
+
+#include <stdint.h>
+#include <stm32f10x.h>
+
+typedef struct {
+	volatile uint32_t	in;			// Producer index (free running)
+	volatile uint32_t	out;		// Consumer index (free running)
+} RING;
+
+#define RING_SLOT(index, size)	((index) & ((size) - 1))
+
+// Reset ring (producer and consumer stopped)
+static __inline void Ring_Init(RING *ring)
+{
+	ring->in  = 0;
+	ring->out = 0;
+}
+
+// Number of used slots (slot access follows the index read)
+static __inline uint32_t Ring_Count(RING *ring)
+{
+	uint32_t n;
+
+	n = ring->in - ring->out;
+	__DMB();
+	return (n);
+}
+
+// Number of free slots
+static __inline uint32_t Ring_Free(RING *ring, uint32_t size)
+{
+	return (size - Ring_Count(ring));
+}
+
+// Producer: publish n slots written from in
+static __inline void Ring_Put(RING *ring, uint32_t n)
+{
+	__DMB();
+	ring->in += n;
+}
+
+// Consumer: release n slots read from out
+static __inline void Ring_Get(RING *ring, uint32_t n)
+{
+	__DMB();
+	ring->out += n;
+}
+
+#endif	/* __RING_H__ */
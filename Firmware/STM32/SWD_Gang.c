@@ -0,0 +1,323 @@
+/******************************************************************************
+ * @file	SWD_Gang.c
+ * @brief	CMSIS-DAP SWD gang mode (several targets with shared SWCLK)
+ *
+ * Every target has its own SWDIO pin on the SWCLK port (GANG_SWDIO_PINS).
+ * Request header and write data are driven to all SWDIO pins with single BSRR
+ * writes, read data is sampled as one IDR bit-plane per clock and separated
+ * per target after the transfer. Every target gets its own ACK and parity
+ * status; targets with a failed transfer are removed from the active set.
+ * Targets answering WAIT are retried on their own (selected subset) while the
+ * other targets see an idle (low) SWDIO line.
+ ******************************************************************************/
+
+#include "DAP_config.h"
+#include "..\DAP.h"
+
+#if ((DAP_SWD != 0) && (DAP_SWD_GANG != 0))
+
+#define GANG_PORT			PIN_SWCLK_TCK_PORT
+
+static const uint8_t Gang_Pin[GANG_COUNT] = GANG_SWDIO_PINS;
+
+static uint32_t Gang_Active;		// Active targets (bit per target)
+static uint32_t Gang_Select;		// Targets addressed by transfers (subset of active)
+static uint16_t Gang_Mask;			// SWDIO pins of selected targets
+static uint32_t Gang_CRL_Mask;		// CRL/CRH mode fields of SWDIO pins
+static uint32_t Gang_CRH_Mask;
+static uint32_t Gang_CRL_Out;		// Output Push/Pull 50 MHz
+static uint32_t Gang_CRH_Out;
+static uint32_t Gang_CRL_In;		// Input with pull-up/pull-down
+static uint32_t Gang_CRH_In;
+
+#define GANG_DELAY()		PIN_DELAY_SLOW(DAP_Data.clock_delay)
+
+#define GANG_CLOCK_CYCLE()		\
+		PIN_SWCLK_TCK_CLR();	\
+		GANG_DELAY();			\
+		PIN_SWCLK_TCK_SET();	\
+		GANG_DELAY()
+
+#define GANG_WRITE_BIT(bit)		\
+		GANG_PORT->BSRR = ((bit) & 1) ? Gang_Mask : ((uint32_t)Gang_Mask << 16);	\
+		GANG_CLOCK_CYCLE()
+
+// Write bit to SWDIO pins in mask, other selected pins are driven low
+#define GANG_WRITE_DATA(bit, mask)	\
+		GANG_PORT->BSRR = ((bit) & 1) ? (mask) : ((uint32_t)Gang_Mask << 16);	\
+		GANG_CLOCK_CYCLE()
+
+#define GANG_READ_BITS(sample)	\
+		PIN_SWCLK_TCK_CLR();	\
+		GANG_DELAY();			\
+		sample = GANG_PORT->IDR;\
+		PIN_SWCLK_TCK_SET();	\
+		GANG_DELAY()
+
+// Switch SWDIO pins of selected targets to output (driven low)
+static __inline void GANG_OUT_ENABLE(void)
+{
+	GANG_PORT->CRL = (GANG_PORT->CRL & ~Gang_CRL_Mask) | Gang_CRL_Out;
+	GANG_PORT->CRH = (GANG_PORT->CRH & ~Gang_CRH_Mask) | Gang_CRH_Out;
+	GANG_PORT->BRR = Gang_Mask;
+}
+
+// Switch SWDIO pins of selected targets to input with pull-up
+static __inline void GANG_OUT_DISABLE(void)
+{
+	GANG_PORT->CRL = (GANG_PORT->CRL & ~Gang_CRL_Mask) | Gang_CRL_In;
+	GANG_PORT->CRH = (GANG_PORT->CRH & ~Gang_CRH_Mask) | Gang_CRH_In;
+	GANG_PORT->BSRR = Gang_Mask;
+}
+
+// Get bit of target from IDR sample
+#define GANG_BIT(sample, target)	(((sample) >> Gang_Pin[target]) & 1)
+
+
+// Get SWDIO pins of targets
+//	targets: bit mask of targets
+//	return:	 pin mask
+static uint32_t Gang_PinMask(uint32_t targets)
+{
+	uint32_t mask;
+	uint32_t n;
+
+	mask = 0;
+	for (n = 0; n < GANG_COUNT; n++)
+	{
+		if (targets & (1 << n))
+			mask |= PIN_MASK(Gang_Pin[n]);
+	}
+	return (mask);
+}
+
+// Prepare SWDIO pin masks of selected targets
+//	targets: bit mask of targets
+//	return:	 none
+static void Gang_PinSetup(uint32_t targets)
+{
+	uint32_t n, pin;
+
+	Gang_Select   = targets;
+	Gang_Mask     = 0;
+	Gang_CRL_Mask = 0;	Gang_CRL_Out = 0;	Gang_CRL_In = 0;
+	Gang_CRH_Mask = 0;	Gang_CRH_Out = 0;	Gang_CRH_In = 0;
+
+	for (n = 0; n < GANG_COUNT; n++)
+	{
+		if ((targets & (1 << n)) == 0)
+			continue;
+		pin = Gang_Pin[n];
+		Gang_Mask |= PIN_MASK(pin);
+		if (pin >= 8)
+		{
+			Gang_CRH_Mask |= PIN_MODE_MASK(pin - 8);
+			Gang_CRH_Out  |= PIN_MODE(0x3, pin - 8);
+			Gang_CRH_In   |= PIN_MODE(0x8, pin - 8);
+		}
+		else
+		{
+			Gang_CRL_Mask |= PIN_MODE_MASK(pin);
+			Gang_CRL_Out  |= PIN_MODE(0x3, pin);
+			Gang_CRL_In   |= PIN_MODE(0x8, pin);
+		}
+	}
+}
+
+// Set active gang targets
+//	targets: bit mask of targets (0 = gang mode off)
+//	return:	 none
+static void SWD_GangSetup(uint32_t targets)
+{
+	Gang_Active = targets & ((1 << GANG_COUNT) - 1);
+	Gang_PinSetup(Gang_Active);
+	if (Gang_Active)
+	{
+		GANG_OUT_ENABLE();
+		GANG_PORT->BSRR = Gang_Mask;
+	}
+}
+
+// Select active targets addressed by the following transfers
+//	targets: bit mask of targets (subset of active targets)
+//	return:	 none
+static void SWD_GangSelect(uint32_t targets)
+{
+	uint32_t mask;
+
+	mask = Gang_Mask;
+	Gang_PinSetup(targets & Gang_Active);
+	GANG_PORT->BRR = mask & ~Gang_Mask;			/* Idle (low) SWDIO on other targets */
+}
+
+// Generate SWJ Sequence on all active targets
+//	count:	sequence bit count
+//	data:	pointer to sequence bit data
+//	return: none
+static void SWD_GangSequence(uint32_t count, uint8_t *data)
+{
+	uint32_t val;
+	uint32_t n;
+
+	val = 0;
+	for (n = 0; n < count; n++)
+	{
+		if ((n & 7) == 0)
+			val = *data++;
+		GANG_WRITE_BIT(val);
+		val >>= 1;
+	}
+}
+
+// SWD Transfer I/O on selected targets
+//	request: A[3:2] RnW APnDP
+//	data:	 DATA[31:0] (write: all targets, read: per target)
+//	ack:	 ACK[2:0] per target (unchanged for targets not selected)
+//	return:	 bit mask of targets with OK response
+static uint32_t SWD_GangTransfer(uint32_t request, uint32_t *data, uint8_t *ack)
+{
+	uint16_t sample[3 + 32 + 1];
+	uint32_t ok, wait;
+	uint32_t mask;
+	uint32_t parity;
+	uint32_t val;
+	uint32_t bit;
+	uint32_t n, k;
+
+	/* Packet Request */
+	parity = 0;
+	GANG_WRITE_BIT(1);							/* Start Bit */
+	for (n = 0; n < 4; n++)
+	{
+		bit = request >> n;
+		GANG_WRITE_BIT(bit);					/* APnDP, RnW, A2, A3 */
+		parity += bit;
+	}
+	GANG_WRITE_BIT(parity);						/* Parity Bit */
+	GANG_WRITE_BIT(0);							/* Stop Bit */
+	GANG_WRITE_BIT(1);							/* Park Bit */
+
+	/* Turnaround */
+	GANG_OUT_DISABLE();
+	for (n = DAP_Data.swd_conf.turnaround; n != 0; n--)
+	{
+		GANG_CLOCK_CYCLE();
+	}
+
+	/* Acknowledge response of all targets */
+	GANG_READ_BITS(sample[0]);
+	GANG_READ_BITS(sample[1]);
+	GANG_READ_BITS(sample[2]);
+
+	ok   = 0;
+	wait = 0;
+	for (k = 0; k < GANG_COUNT; k++)
+	{
+		if ((Gang_Select & (1 << k)) == 0)
+			continue;
+		ack[k] = (GANG_BIT(sample[0], k) << 0)
+			   | (GANG_BIT(sample[1], k) << 1)
+			   | (GANG_BIT(sample[2], k) << 2);
+		if (ack[k] == DAP_TRANSFER_OK)
+			ok   |= 1 << k;
+		if ((ack[k] == DAP_TRANSFER_WAIT) || (ack[k] == DAP_TRANSFER_FAULT))
+			wait |= 1 << k;
+	}
+
+	if (ok)
+	{	/* Data phase for targets with OK response, targets with WAIT or FAULT */
+		/* response see a low SWDIO (idle cycles or dummy data phase)			*/
+		mask = Gang_PinMask(ok);
+		if (request & DAP_TRANSFER_RnW)
+		{
+			GANG_PORT->BRR = Gang_Mask & ~mask;	/* Pull-down on other targets */
+			for (n = 0; n < 32 + 1; n++)
+			{
+				GANG_READ_BITS(sample[3 + n]);	/* Read RDATA[0:31] + Parity */
+			}
+			for (n = DAP_Data.swd_conf.turnaround; n != 0; n--)
+			{
+				GANG_CLOCK_CYCLE();				/* Turnaround */
+			}
+			GANG_OUT_ENABLE();
+
+			for (k = 0; k < GANG_COUNT; k++)
+			{	/* Demultiplex bit-planes */
+				if ((ok & (1 << k)) == 0)
+					continue;
+				val = 0;
+				parity = 0;
+				for (n = 0; n < 32; n++)
+				{
+					bit = GANG_BIT(sample[3 + n], k);
+					parity += bit;
+					val |= bit << n;
+				}
+				if ((parity ^ GANG_BIT(sample[3 + 32], k)) & 1)
+				{
+					ack[k] = DAP_TRANSFER_ERROR;
+					ok &= ~(1 << k);
+				}
+				data[k] = val;
+			}
+		}
+		else
+		{
+			for (n = DAP_Data.swd_conf.turnaround; n != 0; n--)
+			{
+				GANG_CLOCK_CYCLE();				/* Turnaround */
+			}
+			GANG_OUT_ENABLE();
+			val = data[0];
+			parity = 0;
+			for (n = 32; n != 0; n--)
+			{
+				GANG_WRITE_DATA(val, mask);		/* Write WDATA[0:31] */
+				parity += val;
+				val >>= 1;
+			}
+			GANG_WRITE_DATA(parity, mask);		/* Write Parity Bit */
+		}
+		/* Idle cycles */
+		GANG_PORT->BRR = Gang_Mask;
+		for (n = DAP_Data.transfer.idle_cycles; n != 0; n--)
+		{
+			GANG_CLOCK_CYCLE();
+		}
+	}
+	else if (wait)
+	{	/* WAIT or FAULT response (targets with protocol error are removed) */
+		if (DAP_Data.swd_conf.data_phase && (request & DAP_TRANSFER_RnW) != 0)
+		{
+			for (n = 32 + 1; n != 0; n--)
+			{
+				GANG_CLOCK_CYCLE();				/* Dummy Read RDATA[0:31] + Parity */
+			}
+		}
+		for (n = DAP_Data.swd_conf.turnaround; n != 0; n--)
+		{
+			GANG_CLOCK_CYCLE();					/* Turnaround */
+		}
+		GANG_OUT_ENABLE();
+		if (DAP_Data.swd_conf.data_phase && (request & DAP_TRANSFER_RnW) == 0)
+		{
+			for (n = 32 + 1; n != 0; n--)
+			{
+				GANG_CLOCK_CYCLE();				/* Dummy Write WDATA[0:31] + Parity */
+			}
+		}
+	}
+	else
+	{	/* Protocol error */
+		for (n = DAP_Data.swd_conf.turnaround + 32 + 1; n != 0; n--)
+		{
+			GANG_CLOCK_CYCLE();					/* Back off data phase */
+		}
+		GANG_OUT_ENABLE();
+	}
+
+	GANG_PORT->BSRR = Gang_Mask;
+	return (ok);
+}
+
+#endif	/* ((DAP_SWD != 0) && (DAP_SWD_GANG != 0)) */
@@ -0,0 +1,501 @@
+/******************************************************************************
+ * @file	SWJ_DMA.c
+ * @brief	CMSIS-DAP SWD/JTAG waveform engine (STM32F10x Timer + DMA)
+ *
+ * The SWD/JTAG signals are not toggled by the CPU. Every clock cycle is
+ * pre-encoded into two BSRR words (clock low with data, clock high) which are
+ * written to the port by DMA1 Channel 3 on each TIM3 update event. TIM3
+ * compare channel 3 triggers DMA1 Channel 2 late in every timer period and
+ * stores the port IDR into a capture buffer, which is decoded after the burst.
+ *
+ * SWD and JTAG transfers are split into bursts only where the protocol needs
+ * a decision (SWDIO direction change, ACK check). Inside a burst the clock is
+ * not affected by interrupts or flash wait states. A burst that does not end
+ * in twice its nominal time (timer or DMA not running) stops the transfer
+ * with DAP_TRANSFER_ERROR instead of hanging the probe.
+ ******************************************************************************/
+
+#include "DAP_config.h"
+#include "..\DAP.h"
+
+#if (DAP_SWJ_DMA != 0)
+
+#define SWJ_DMA_TIM			TIM3
+#define SWJ_DMA_OUT			DMA1_Channel3	// TIM3_UP:  Table -> BSRR
+#define SWJ_DMA_IN			DMA1_Channel2	// TIM3_CH3: IDR   -> Capture
+#define SWJ_DMA_DONE		(DMA_ISR_TCIF2  | DMA_ISR_TCIF3)
+#define SWJ_DMA_CLEAR		(DMA_IFCR_CGIF2 | DMA_IFCR_CGIF3)
+
+#define SWJ_DMA_PORT		PIN_SWCLK_TCK_PORT
+#define SWJ_DMA_BITS		64				// Maximum clock cycles per burst
+
+// BSRR patterns for the data pins (0 = pin not changed)
+#define SWDIO_BSRR(bit)		(((bit) & 1) ? PIN_SWDIO_TMS : (PIN_SWDIO_TMS << 16))
+#define TMS_BSRR(bit)		SWDIO_BSRR(bit)
+#if (DAP_JTAG != 0)
+#define TDI_BSRR(bit)		(((bit) & 1) ? PIN_TDI : (PIN_TDI << 16))
+#endif
+
+// Captured pin state of clock cycle n of the last burst (sampled before rising edge)
+#define SWJ_DMA_SWDIO(n)	((SWJ_DMA_Capture[2 * (n) + 1] & PIN_SWDIO_TMS) ? 1 : 0)
+#if (DAP_JTAG != 0)
+#define SWJ_DMA_TDO(n)		((SWJ_DMA_Capture[2 * (n) + 1] & PIN_TDO) ? 1 : 0)
+#endif
+
+static uint32_t SWJ_DMA_Table  [2 * SWJ_DMA_BITS];	// BSRR words
+static uint16_t SWJ_DMA_Capture[2 * SWJ_DMA_BITS];	// IDR samples
+static uint32_t SWJ_DMA_Count;						// Number of BSRR words
+static uint8_t  SWJ_DMA_Timeout;					// Burst not finished in time (sticky per transfer)
+
+
+// Run the encoded burst and wait until it is finished
+//	return: none (SWJ_DMA_Timeout is set if the burst did not finish)
+static void SWJ_DMA_Run(void)
+{
+	uint32_t count;
+	uint32_t start;
+	uint32_t limit;
+
+	count = SWJ_DMA_Count;
+	SWJ_DMA_Count = 0;
+	if ((count == 0) || SWJ_DMA_Timeout)
+		return;
+
+	SWJ_DMA_OUT->CCR   = 0;
+	SWJ_DMA_OUT->CNDTR = count;
+	SWJ_DMA_OUT->CMAR  = (uint32_t)SWJ_DMA_Table;
+	SWJ_DMA_OUT->CCR   = DMA_CCR1_PL | DMA_CCR1_MSIZE_1 | DMA_CCR1_PSIZE_1
+					   | DMA_CCR1_MINC | DMA_CCR1_DIR | DMA_CCR1_EN;
+
+	SWJ_DMA_IN->CCR    = 0;
+	SWJ_DMA_IN->CNDTR  = count;
+	SWJ_DMA_IN->CMAR   = (uint32_t)SWJ_DMA_Capture;
+	SWJ_DMA_IN->CCR    = DMA_CCR1_PL_1 | DMA_CCR1_MSIZE_0 | DMA_CCR1_PSIZE_1
+					   | DMA_CCR1_MINC | DMA_CCR1_EN;
+
+	// Twice the nominal burst time in CPU cycles (timer clock is CPU_CLOCK/2)
+	limit = 2 * 2 * count * (SWJ_DMA_TIM->ARR + 1) + 1000;
+
+	DMA1->IFCR = SWJ_DMA_CLEAR;
+	SWJ_DMA_TIM->CNT = 0;
+	SWJ_DMA_TIM->CR1 = TIM_CR1_CEN;
+
+	start = DWT->CYCCNT;
+	while ((DMA1->ISR & SWJ_DMA_DONE) != SWJ_DMA_DONE)
+	{
+		if ((DWT->CYCCNT - start) > limit)
+		{
+			SWJ_DMA_Timeout = 1;
+			break;
+		}
+	}
+
+	SWJ_DMA_TIM->CR1 = 0;
+	if (SWJ_DMA_Timeout)
+	{
+		SWJ_DMA_OUT->CCR = 0;
+		SWJ_DMA_IN->CCR  = 0;
+	}
+}
+
+// Get transfer result
+//	ack:	ACK[2:0] decoded from the captured bursts
+//	return:	ACK[2:0], DAP_TRANSFER_ERROR if a burst did not finish
+static __inline uint8_t SWJ_DMA_Result(uint32_t ack)
+{
+	return (SWJ_DMA_Timeout ? DAP_TRANSFER_ERROR : (uint8_t)ack);
+}
+
+// Append one clock cycle to the burst
+//	bsrr:	data pin pattern for the clock low phase
+//	return:	none
+static __inline void SWJ_DMA_Cycle(uint32_t bsrr)
+{
+	if (SWJ_DMA_Count == (2 * SWJ_DMA_BITS))
+	{	// Only output cycles may overflow a burst
+		SWJ_DMA_Run();
+	}
+	SWJ_DMA_Table[SWJ_DMA_Count++] = bsrr | (PIN_SWCLK_TCK << 16);
+	SWJ_DMA_Table[SWJ_DMA_Count++] = PIN_SWCLK_TCK;
+}
+
+
+// Setup Timer and DMA channels of the waveform engine
+//	return: none
+void SWJ_DMA_Setup(void)
+{
+	RCC->AHBENR  |= RCC_AHBENR_DMA1EN;
+	RCC->APB1ENR |= RCC_APB1ENR_TIM3EN;
+
+	SWJ_DMA_TIM->CR1   = 0;
+	SWJ_DMA_TIM->PSC   = 0;
+	SWJ_DMA_TIM->CCMR2 = 0;				// CC3: frozen output compare
+	SWJ_DMA_TIM->DIER  = TIM_DIER_UDE | TIM_DIER_CC3DE;
+
+	SWJ_DMA_OUT->CCR   = 0;
+	SWJ_DMA_OUT->CPAR  = (uint32_t)&SWJ_DMA_PORT->BSRR;
+	SWJ_DMA_IN->CCR    = 0;
+	SWJ_DMA_IN->CPAR   = (uint32_t)&SWJ_DMA_PORT->IDR;
+
+	SWJ_DMA_Count   = 0;
+	SWJ_DMA_Timeout = 0;
+
+	// DWT cycle counter times out bursts
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+// Configure SWCLK/TCK frequency of the waveform engine
+//	clock:	requested frequency in Hz
+//	return:	actual frequency in Hz, 0 = clock is out of DMA range
+uint32_t SWJ_DMA_Clock(uint32_t clock)
+{
+	uint32_t ticks;
+
+	// TIM3 runs at CPU_CLOCK (APB1 prescaler is 2)
+	ticks = (CPU_CLOCK / 2 + (clock - 1)) / clock;
+	if (ticks < SWJ_DMA_MIN_TICKS)
+		return (0);
+	if (ticks > 0x10000)
+		ticks = 0x10000;
+
+	SWJ_DMA_TIM->ARR  = ticks - 1;
+	SWJ_DMA_TIM->CCR3 = (ticks * 3) / 4;	// Sample late in the clock low phase
+	return (CPU_CLOCK / 2 / ticks);
+}
+
+
+#if (DAP_SWD != 0)
+
+// SWD Transfer I/O
+//	request: A[3:2] RnW APnDP
+//	data:	DATA[31:0]
+//	return:  ACK[2:0]
+uint8_t SWD_TransferDMA(uint8_t request, uint32_t *data)
+{
+	uint32_t ack;
+	uint32_t bit;
+	uint32_t val;
+	uint32_t parity;
+	uint32_t n;
+
+	SWJ_DMA_Timeout = 0;
+
+	/* Packet Request */
+	parity = 0;
+	SWJ_DMA_Cycle(SWDIO_BSRR(1));				/* Start Bit */
+	for (n = 0; n < 4; n++)
+	{
+		bit = request >> n;
+		SWJ_DMA_Cycle(SWDIO_BSRR(bit));			/* APnDP, RnW, A2, A3 */
+		parity += bit;
+	}
+	SWJ_DMA_Cycle(SWDIO_BSRR(parity));			/* Parity Bit */
+	SWJ_DMA_Cycle(SWDIO_BSRR(0));				/* Stop Bit */
+	SWJ_DMA_Cycle(SWDIO_BSRR(1));				/* Park Bit */
+	SWJ_DMA_Run();
+
+	/* Turnaround + Acknowledge response */
+	PIN_SWDIO_OUT_DISABLE();
+	for (n = DAP_Data.swd_conf.turnaround; n != 0; n--)
+	{
+		SWJ_DMA_Cycle(0);
+	}
+	SWJ_DMA_Cycle(0);
+	SWJ_DMA_Cycle(0);
+	SWJ_DMA_Cycle(0);
+	SWJ_DMA_Run();
+
+	n   = DAP_Data.swd_conf.turnaround;
+	ack = (SWJ_DMA_SWDIO(n + 0) << 0)
+		| (SWJ_DMA_SWDIO(n + 1) << 1)
+		| (SWJ_DMA_SWDIO(n + 2) << 2);
+
+	if (ack == DAP_TRANSFER_OK)
+	{	/* OK response */
+		if (request & DAP_TRANSFER_RnW)
+		{	/* Read RDATA[0:31] + Parity + Turnaround */
+			for (n = 32 + 1 + DAP_Data.swd_conf.turnaround; n != 0; n--)
+			{
+				SWJ_DMA_Cycle(0);
+			}
+			SWJ_DMA_Run();
+
+			val = 0;
+			parity = 0;
+			for (n = 0; n < 32; n++)
+			{
+				bit = SWJ_DMA_SWDIO(n);
+				parity += bit;
+				val |= bit << n;
+			}
+			if ((parity ^ SWJ_DMA_SWDIO(32)) & 1)
+			{
+				ack = DAP_TRANSFER_ERROR;
+			}
+			if (data) *data = val;
+			PIN_SWDIO_OUT_ENABLE();
+		}
+		else
+		{	/* Turnaround */
+			for (n = DAP_Data.swd_conf.turnaround; n != 0; n--)
+			{
+				SWJ_DMA_Cycle(0);
+			}
+			SWJ_DMA_Run();
+			PIN_SWDIO_OUT_ENABLE();
+
+			/* Write WDATA[0:31] + Parity */
+			val = *data;
+			parity = 0;
+			for (n = 32; n != 0; n--)
+			{
+				SWJ_DMA_Cycle(SWDIO_BSRR(val));
+				parity += val;
+				val >>= 1;
+			}
+			SWJ_DMA_Cycle(SWDIO_BSRR(parity));
+		}
+		/* Idle cycles */
+		for (n = DAP_Data.transfer.idle_cycles; n != 0; n--)
+		{
+			SWJ_DMA_Cycle(SWDIO_BSRR(0));
+		}
+		SWJ_DMA_Run();
+		PIN_SWDIO_OUT(1);
+		return (SWJ_DMA_Result(ack));
+	}
+
+	if (ack == DAP_TRANSFER_WAIT || ack == DAP_TRANSFER_FAULT)
+	{	/* WAIT or FAULT response */
+		if (DAP_Data.swd_conf.data_phase && (request & DAP_TRANSFER_RnW) != 0)
+		{
+			for (n = 32 + 1; n != 0; n--)
+			{
+				SWJ_DMA_Cycle(0);						/* Dummy Read RDATA[0:31] + Parity */
+			}
+		}
+		for (n = DAP_Data.swd_conf.turnaround; n != 0; n--)
+		{
+			SWJ_DMA_Cycle(0);							/* Turnaround */
+		}
+		SWJ_DMA_Run();
+
+		PIN_SWDIO_OUT_ENABLE();
+		if (DAP_Data.swd_conf.data_phase && (request & DAP_TRANSFER_RnW) == 0)
+		{
+			for (n = 32 + 1; n != 0; n--)
+			{
+				SWJ_DMA_Cycle(SWDIO_BSRR(0));			/* Dummy Write WDATA[0:31] + Parity */
+			}
+			SWJ_DMA_Run();
+		}
+		PIN_SWDIO_OUT(1);
+		return (SWJ_DMA_Result(ack));
+	}
+
+	/* Protocol error */
+	for (n = DAP_Data.swd_conf.turnaround + 32 + 1; n != 0; n--)
+	{
+		SWJ_DMA_Cycle(0);								/* Back off data phase */
+	}
+	SWJ_DMA_Run();
+
+	PIN_SWDIO_OUT_ENABLE();
+	PIN_SWDIO_OUT(1);
+	return (SWJ_DMA_Result(ack));
+}
+
+#endif	/* (DAP_SWD != 0) */
+
+
+#if (DAP_JTAG != 0)
+
+// Generate JTAG Sequence
+//	info:	sequence information
+//	tdi:	pointer to TDI generated data
+//	tdo:	pointer to TDO captured data
+//	return:	none
+void JTAG_SequenceDMA(uint32_t info, uint8_t *tdi, uint8_t *tdo)
+{
+	uint32_t tms;
+	uint32_t val;
+	uint32_t n, k, i;
+
+	SWJ_DMA_Timeout = 0;
+
+	n = info & JTAG_SEQUENCE_TCK;
+	if (n == 0) n = 64;
+
+	tms = TMS_BSRR((info & JTAG_SEQUENCE_TMS) ? 1 : 0);
+	for (k = 0; k < n; k++)
+	{
+		SWJ_DMA_Cycle(tms | TDI_BSRR(tdi[k >> 3] >> (k & 7)));
+	}
+	SWJ_DMA_Run();
+
+	if (info & JTAG_SEQUENCE_TDO)
+	{
+		for (k = 0; k < n; k += 8)
+		{
+			val = 0;
+			for (i = 0; (i < 8) && ((k + i) < n); i++)
+			{
+				val |= SWJ_DMA_TDO(k + i) << i;
+			}
+			*tdo++ = val;
+		}
+	}
+}
+
+// JTAG Set IR
+//	ir:		IR value
+//	return:	none
+void JTAG_IR_DMA(uint32_t ir)
+{
+	uint32_t n;
+
+	SWJ_DMA_Timeout = 0;
+
+	SWJ_DMA_Cycle(TMS_BSRR(1));							/* Select-DR-Scan */
+	SWJ_DMA_Cycle(TMS_BSRR(1));							/* Select-IR-Scan */
+	SWJ_DMA_Cycle(TMS_BSRR(0));							/* Capture-IR */
+	SWJ_DMA_Cycle(TMS_BSRR(0));							/* Shift-IR */
+
+	for (n = DAP_Data.jtag_dev.ir_before[DAP_Data.jtag_dev.index]; n; n--)
+	{
+		SWJ_DMA_Cycle(TMS_BSRR(0) | TDI_BSRR(1));		/* Bypass before data */
+	}
+	for (n = DAP_Data.jtag_dev.ir_length[DAP_Data.jtag_dev.index] - 1; n; n--)
+	{
+		SWJ_DMA_Cycle(TMS_BSRR(0) | TDI_BSRR(ir));		/* Set IR bits (except last) */
+		ir >>= 1;
+	}
+	n = DAP_Data.jtag_dev.ir_after[DAP_Data.jtag_dev.index];
+	if (n)
+	{
+		SWJ_DMA_Cycle(TMS_BSRR(0) | TDI_BSRR(ir));		/* Set last IR bit */
+		for (--n; n; n--)
+		{
+			SWJ_DMA_Cycle(TMS_BSRR(0) | TDI_BSRR(1));	/* Bypass after data */
+		}
+		SWJ_DMA_Cycle(TMS_BSRR(1) | TDI_BSRR(1));		/* Bypass & Exit1-IR */
+	}
+	else
+	{
+		SWJ_DMA_Cycle(TMS_BSRR(1) | TDI_BSRR(ir));		/* Set last IR bit & Exit1-IR */
+	}
+
+	SWJ_DMA_Cycle(TMS_BSRR(1));							/* Update-IR */
+	SWJ_DMA_Cycle(TMS_BSRR(0));							/* Idle */
+	SWJ_DMA_Run();
+	PIN_TDI_OUT(1);
+}
+
+// JTAG Transfer I/O
+//	request: A[3:2] RnW APnDP
+//	data:	DATA[31:0]
+//	return:  ACK[2:0]
+uint8_t JTAG_TransferDMA(uint32_t request, uint32_t *data)
+{
+	uint32_t ack;
+	uint32_t val;
+	uint32_t n, k;
+
+	SWJ_DMA_Timeout = 0;
+
+	SWJ_DMA_Cycle(TMS_BSRR(1));							/* Select-DR-Scan */
+	SWJ_DMA_Cycle(TMS_BSRR(0));							/* Capture-DR */
+	SWJ_DMA_Cycle(TMS_BSRR(0));							/* Shift-DR */
+
+	for (n = DAP_Data.jtag_dev.index; n; n--)
+	{
+		SWJ_DMA_Cycle(TMS_BSRR(0));						/* Bypass before data */
+	}
+
+	SWJ_DMA_Cycle(TMS_BSRR(0) | TDI_BSRR(request >> 1));	/* Set RnW, Get ACK.0 */
+	SWJ_DMA_Cycle(TMS_BSRR(0) | TDI_BSRR(request >> 2));	/* Set A2,  Get ACK.1 */
+	SWJ_DMA_Cycle(TMS_BSRR(0) | TDI_BSRR(request >> 3));	/* Set A3,  Get ACK.2 */
+	SWJ_DMA_Run();
+
+	k   = 3 + DAP_Data.jtag_dev.index;
+	ack = (SWJ_DMA_TDO(k + 0) << 1)
+		| (SWJ_DMA_TDO(k + 1) << 0)
+		| (SWJ_DMA_TDO(k + 2) << 2);
+
+	if (ack != DAP_TRANSFER_OK)
+	{	/* Exit on error */
+		SWJ_DMA_Cycle(TMS_BSRR(1));						/* Exit1-DR */
+		goto exit;
+	}
+
+	n = DAP_Data.jtag_dev.count - DAP_Data.jtag_dev.index - 1;
+	if (request & DAP_TRANSFER_RnW)
+	{	/* Read Transfer */
+		for (k = 31; k; k--)
+		{
+			SWJ_DMA_Cycle(TMS_BSRR(0));					/* Get D0..D30 */
+		}
+		if (n)
+		{
+			SWJ_DMA_Cycle(TMS_BSRR(0));					/* Get D31 */
+			for (k = n - 1; k; k--)
+			{
+				SWJ_DMA_Cycle(TMS_BSRR(0));				/* Bypass after data */
+			}
+			SWJ_DMA_Cycle(TMS_BSRR(1));					/* Bypass & Exit1-DR */
+		}
+		else
+		{
+			SWJ_DMA_Cycle(TMS_BSRR(1));					/* Get D31 & Exit1-DR */
+		}
+		SWJ_DMA_Run();
+
+		val = 0;
+		for (k = 0; k < 32; k++)
+		{
+			val |= SWJ_DMA_TDO(k) << k;
+		}
+		if (data) *data = val;
+	}
+	else
+	{	/* Write Transfer */
+		val = *data;
+		for (k = 31; k; k--)
+		{
+			SWJ_DMA_Cycle(TMS_BSRR(0) | TDI_BSRR(val));	/* Set D0..D30 */
+			val >>= 1;
+		}
+		if (n)
+		{
+			SWJ_DMA_Cycle(TMS_BSRR(0) | TDI_BSRR(val));	/* Set D31 */
+			for (k = n - 1; k; k--)
+			{
+				SWJ_DMA_Cycle(TMS_BSRR(0));				/* Bypass after data */
+			}
+			SWJ_DMA_Cycle(TMS_BSRR(1));					/* Bypass & Exit1-DR */
+		}
+		else
+		{
+			SWJ_DMA_Cycle(TMS_BSRR(1) | TDI_BSRR(val));	/* Set D31 & Exit1-DR */
+		}
+	}
+
+exit:
+	SWJ_DMA_Cycle(TMS_BSRR(1));							/* Update-DR */
+	SWJ_DMA_Cycle(TMS_BSRR(0));							/* Idle */
+
+	/* Idle cycles */
+	for (n = DAP_Data.transfer.idle_cycles; n; n--)
+	{
+		SWJ_DMA_Cycle(TMS_BSRR(0) | TDI_BSRR(1));		/* Idle */
+	}
+	SWJ_DMA_Run();
+	PIN_TDI_OUT(1);
+
+	return (SWJ_DMA_Result(ack));
+}
+
+#endif	/* (DAP_JTAG != 0) */
+
+#endif	/* (DAP_SWJ_DMA != 0) */
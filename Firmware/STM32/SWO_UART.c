@@ -0,0 +1,237 @@
+/******************************************************************************
+ * @file	SWO_UART.c
+ * @brief	CMSIS-DAP SWO capture in UART (NRZ) mode (STM32F10x USART + DMA)
+ *
+ * The SWO pin is connected to a USART RX pin. Received trace bytes are stored
+ * by a DMA channel in circular mode into the SWO buffer, the CPU is not
+ * involved per byte. The DMA half and transfer complete interrupt advances the
+ * write position, the SWO commands update it to the actual DMA position.
+ * Buffer overruns are detected from the DMA half and transfer complete flags,
+ * so laps between two updates are not missed.
+ ******************************************************************************/
+
+#include "DAP_config.h"
+#include "..\DAP.h"
+
+#if (DAP_SWO != 0)
+
+#if ((SWO_BUFFER_SIZE & (SWO_BUFFER_SIZE - 1)) != 0)
+#error "SWO_BUFFER_SIZE must be 2^n"
+#endif
+
+#define SWO_HALF			(SWO_BUFFER_SIZE / 2)
+#define SWO_USART_ERRORS	(USART_SR_ORE | USART_SR_NE | USART_SR_FE)
+
+static struct {
+	uint8_t		mode;			// SWO mode (DAP_SWO_OFF or DAP_SWO_UART)
+	uint8_t		status;			// Trace status (DAP_SWO_CAPTURE_ACTIVE, errors)
+	uint32_t	baudrate;		// Actual baudrate (0 = not set)
+	uint32_t	in;				// Bytes written by DMA (free running)
+	uint32_t	out;			// Bytes read by host (free running)
+} SWO;
+
+static uint8_t SWO_Buffer[SWO_BUFFER_SIZE];
+
+const GPIO_InitTypeDef SWO_RX_INIT   = {	SWO_RX_PIN,	GPIO_Speed_50MHz,		GPIO_Mode_IN_FLOATING	};
+const GPIO_InitTypeDef SWO_RX_DEINIT = {	SWO_RX_PIN,	(GPIOSpeed_TypeDef)0,	GPIO_Mode_IPU			};
+
+
+// Update write position from DMA and check for overrun
+//   Called by the DMA interrupt and with the DMA interrupt disabled.
+//	return:	none
+static void SWO_UART_Update(void)
+{
+	uint32_t flags;
+	uint32_t crossed;
+	uint32_t last, pos;
+
+	if (!(SWO.status & DAP_SWO_CAPTURE_ACTIVE))
+		return;
+
+	flags = DMA1->ISR & (SWO_DMA_HT | SWO_DMA_TC);
+	pos   = (SWO_BUFFER_SIZE - SWO_DMA->CNDTR) & (SWO_BUFFER_SIZE - 1);
+	last  = SWO.in & (SWO_BUFFER_SIZE - 1);
+
+	// Buffer boundaries passed from last to actual position
+	crossed = 0;
+	if (pos < last)
+		crossed |= SWO_DMA_TC;
+	if ((last < SWO_HALF) ? ((pos >= SWO_HALF) || (pos < last)) : ((pos >= SWO_HALF) && (pos < last)))
+		crossed |= SWO_DMA_HT;
+	DMA1->IFCR = flags | crossed;		// IFCR bits match ISR bits
+
+	if (SWO_USART_PORT->SR & SWO_USART_ERRORS)
+	{	// Cleared by DMA read of DR
+		SWO.status |= DAP_SWO_STREAM_ERROR;
+	}
+
+	SWO.in += (pos - last) & (SWO_BUFFER_SIZE - 1);
+	if ((flags & ~crossed) || ((SWO.in - SWO.out) >= SWO_BUFFER_SIZE))
+	{	// DMA has overwritten unread data: drop buffer
+		SWO.status |= DAP_SWO_BUFFER_OVERRUN;
+		SWO.out = SWO.in;
+	}
+}
+
+// DMA half transfer and transfer complete interrupt
+void SWO_DMA_IRQHandler(void)
+{
+	SWO_UART_Update();
+}
+
+// Update write position from thread mode
+//	return:	none
+static void SWO_UART_Poll(void)
+{
+	NVIC_DisableIRQ(SWO_DMA_IRQn);
+	SWO_UART_Update();
+	NVIC_EnableIRQ(SWO_DMA_IRQn);
+}
+
+// Enable or disable UART mode (SWO pin, USART and DMA clocks)
+//	enable:	1 = UART mode, 0 = off
+//	return:	1 = ok
+uint32_t SWO_UART_Mode(uint32_t enable)
+{
+	SWO_UART_Control(0);
+	if (enable)
+	{
+		RCC->AHBENR |= RCC_AHBENR_DMA1EN;
+		SWO_GPIO_CLOCK(ENABLE);
+		SWO_USART_CLOCK(ENABLE);
+		GPIO_INIT(SWO_GPIO, SWO_RX_INIT);
+		SWO.mode = DAP_SWO_UART;
+	}
+	else
+	{
+		if (SWO.mode != DAP_SWO_OFF)
+		{
+			GPIO_INIT(SWO_GPIO, SWO_RX_DEINIT);
+			SWO_USART_CLOCK(DISABLE);
+		}
+		SWO.mode = DAP_SWO_OFF;
+	}
+	SWO.baudrate = 0;
+	return (1);
+}
+
+// Configure UART baudrate
+//	baudrate:	requested baudrate in Hz
+//	return:		actual baudrate in Hz, 0 = not supported
+uint32_t SWO_UART_Baudrate(uint32_t baudrate)
+{
+	uint32_t brr;
+
+	SWO_UART_Control(0);
+	if ((SWO.mode != DAP_SWO_UART) || (baudrate == 0))
+		return (0);
+
+	// 16x oversampling: BRR is the clock divider in 1/16 bit
+	brr = (SWO_USART_PCLK + (baudrate / 2)) / baudrate;
+	if (brr < 16)
+		brr = 16;
+	if (brr > 0xFFFF)
+		return (0);
+
+	SWO_USART_PORT->BRR = brr;
+	SWO.baudrate = SWO_USART_PCLK / brr;
+	return (SWO.baudrate);
+}
+
+// Start or stop trace capture
+//	active:	1 = start, 0 = stop
+//	return:	1 = ok, 0 = mode or baudrate not set
+uint32_t SWO_UART_Control(uint32_t active)
+{
+	if (!active)
+	{
+		if (SWO.status & DAP_SWO_CAPTURE_ACTIVE)
+		{
+			NVIC_DisableIRQ(SWO_DMA_IRQn);
+			SWO_UART_Update();
+			SWO_USART_PORT->CR1 = 0;
+			SWO_USART_PORT->CR3 = 0;
+			SWO_DMA->CCR = 0;
+			DMA1->IFCR   = SWO_DMA_CLEAR;
+			NVIC_ClearPendingIRQ(SWO_DMA_IRQn);
+			SWO.status &= ~DAP_SWO_CAPTURE_ACTIVE;
+		}
+		return (1);
+	}
+	if ((SWO.mode != DAP_SWO_UART) || (SWO.baudrate == 0))
+		return (0);
+	if (SWO.status & DAP_SWO_CAPTURE_ACTIVE)
+		return (1);
+
+	SWO.in     = 0;
+	SWO.out    = 0;
+	SWO.status = 0;
+
+	SWO_DMA->CCR   = 0;
+	SWO_DMA->CPAR  = (uint32_t)&SWO_USART_PORT->DR;
+	SWO_DMA->CMAR  = (uint32_t)SWO_Buffer;
+	SWO_DMA->CNDTR = SWO_BUFFER_SIZE;
+	DMA1->IFCR     = SWO_DMA_CLEAR;
+	SWO_DMA->CCR   = DMA_CCR1_PL_0 | DMA_CCR1_MINC | DMA_CCR1_CIRC |
+					 DMA_CCR1_HTIE | DMA_CCR1_TCIE | DMA_CCR1_EN;
+
+	SWO_USART_PORT->CR2 = 0;
+	SWO_USART_PORT->CR3 = USART_CR3_DMAR;
+	SWO_USART_PORT->CR1 = USART_CR1_UE | USART_CR1_RE;
+
+	SWO.status = DAP_SWO_CAPTURE_ACTIVE;
+	NVIC_EnableIRQ(SWO_DMA_IRQn);
+	return (1);
+}
+
+// Get trace status and clear reported errors
+//	return:	DAP_SWO_CAPTURE_ACTIVE, DAP_SWO_STREAM_ERROR, DAP_SWO_BUFFER_OVERRUN
+uint32_t SWO_UART_Status(void)
+{
+	uint32_t status;
+
+	NVIC_DisableIRQ(SWO_DMA_IRQn);
+	SWO_UART_Update();
+	status = SWO.status;
+	SWO.status &= DAP_SWO_CAPTURE_ACTIVE;
+	if (status & DAP_SWO_CAPTURE_ACTIVE)
+		NVIC_EnableIRQ(SWO_DMA_IRQn);
+	return (status);
+}
+
+// Get number of buffered trace bytes (also polls DMA while no USB request is pending)
+//	return:	number of bytes
+uint32_t SWO_UART_Count(void)
+{
+	if (SWO.status & DAP_SWO_CAPTURE_ACTIVE)
+		SWO_UART_Poll();
+	return (SWO.in - SWO.out);
+}
+
+// Read buffered trace bytes
+//	data:	pointer to trace data
+//	count:	maximum number of bytes
+//	return:	number of bytes read
+uint32_t SWO_UART_Read(uint8_t *data, uint32_t count)
+{
+	uint32_t active;
+	uint32_t n;
+
+	// DMA interrupt drops unread data on overrun (SWO.out)
+	active = SWO.status & DAP_SWO_CAPTURE_ACTIVE;
+	NVIC_DisableIRQ(SWO_DMA_IRQn);
+	SWO_UART_Update();
+	n = SWO.in - SWO.out;
+	if (count > n)
+		count = n;
+	for (n = 0; n < count; n++)
+	{
+		*data++ = SWO_Buffer[SWO.out & (SWO_BUFFER_SIZE - 1)];
+		SWO.out++;
+	}
+	if (active)
+		NVIC_EnableIRQ(SWO_DMA_IRQn);
+	return (count);
+}
+
+#endif	/* (DAP_SWO != 0) */
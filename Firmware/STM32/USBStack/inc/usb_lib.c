@@ -127,7 +127,12 @@ const   U16  usbd_cdc_acm_maxpacketsize1[2] = {USBD_CDC_ACM_WMAXPACKETSIZE1, USB
 
 #if    (USBD_HID_ENABLE)
   #ifndef __RTX
+    #if  (USBD_HID_EP_DIRECT)
+  extern void USBD_HID_EP_Direct_Configure (void);
+                                           void USBD_Configure_Event (void)             { USBD_HID_Configure_Event (); USBD_HID_EP_Direct_Configure (); }
+    #else
                                            void USBD_Configure_Event (void)             { USBD_HID_Configure_Event (); }
+    #endif
   #endif
   #ifdef __RTX
     #if   ((USBD_HID_EP_INTOUT != 0) && (USBD_HID_EP_INTIN != USBD_HID_EP_INTOUT))
@@ -260,6 +265,12 @@ const   U16  usbd_cdc_acm_maxpacketsize1[2] = {USBD_CDC_ACM_WMAXPACKETSIZE1, USB
       #endif
     #endif
   #else
+  #if    (USBD_HID_EP_DIRECT)
+  extern void USBD_HID_EP_Direct_Event    (U32 event);
+    #define USBD_HID_EP_INOUT_Event          USBD_HID_EP_Direct_Event
+  #else
+    #define USBD_HID_EP_INOUT_Event          USBD_HID_EP_INT_Event
+  #endif
     #if   ((USBD_HID_EP_INTOUT != 0) && (USBD_HID_EP_INTIN != USBD_HID_EP_INTOUT))
       #if    (USBD_HID_EP_INTIN == 1)
         #define USBD_EndPoint1                 USBD_HID_EP_INTIN_Event
@@ -326,35 +337,35 @@ const   U16  usbd_cdc_acm_maxpacketsize1[2] = {USBD_CDC_ACM_WMAXPACKETSIZE1, USB
       #endif
     #elif    (USBD_HID_EP_INTOUT != 0)
       #if    (USBD_HID_EP_INTIN == 1)
-        #define USBD_EndPoint1                 USBD_HID_EP_INT_Event
+        #define USBD_EndPoint1                 USBD_HID_EP_INOUT_Event
       #elif  (USBD_HID_EP_INTIN == 2)
-        #define USBD_EndPoint2                 USBD_HID_EP_INT_Event
+        #define USBD_EndPoint2                 USBD_HID_EP_INOUT_Event
       #elif  (USBD_HID_EP_INTIN == 3)
-        #define USBD_EndPoint3                 USBD_HID_EP_INT_Event
+        #define USBD_EndPoint3                 USBD_HID_EP_INOUT_Event
       #elif  (USBD_HID_EP_INTIN == 4)
-        #define USBD_EndPoint4                 USBD_HID_EP_INT_Event
+        #define USBD_EndPoint4                 USBD_HID_EP_INOUT_Event
       #elif  (USBD_HID_EP_INTIN == 5)
-        #define USBD_EndPoint5                 USBD_HID_EP_INT_Event
+        #define USBD_EndPoint5                 USBD_HID_EP_INOUT_Event
       #elif  (USBD_HID_EP_INTIN == 6)
-        #define USBD_EndPoint6                 USBD_HID_EP_INT_Event
+        #define USBD_EndPoint6                 USBD_HID_EP_INOUT_Event
       #elif  (USBD_HID_EP_INTIN == 7)
-        #define USBD_EndPoint7                 USBD_HID_EP_INT_Event
+        #define USBD_EndPoint7                 USBD_HID_EP_INOUT_Event
       #elif  (USBD_HID_EP_INTIN == 8)
-        #define USBD_EndPoint8                 USBD_HID_EP_INT_Event
+        #define USBD_EndPoint8                 USBD_HID_EP_INOUT_Event
       #elif  (USBD_HID_EP_INTIN == 9)
-        #define USBD_EndPoint9                 USBD_HID_EP_INT_Event
+        #define USBD_EndPoint9                 USBD_HID_EP_INOUT_Event
       #elif  (USBD_HID_EP_INTIN == 10)
-        #define USBD_EndPoint10                USBD_HID_EP_INT_Event
+        #define USBD_EndPoint10                USBD_HID_EP_INOUT_Event
       #elif  (USBD_HID_EP_INTIN == 11)
-        #define USBD_EndPoint11                USBD_HID_EP_INT_Event
+        #define USBD_EndPoint11                USBD_HID_EP_INOUT_Event
       #elif  (USBD_HID_EP_INTIN == 12)
-        #define USBD_EndPoint12                USBD_HID_EP_INT_Event
+        #define USBD_EndPoint12                USBD_HID_EP_INOUT_Event
       #elif  (USBD_HID_EP_INTIN == 13)
-        #define USBD_EndPoint13                USBD_HID_EP_INT_Event
+        #define USBD_EndPoint13                USBD_HID_EP_INOUT_Event
       #elif  (USBD_HID_EP_INTIN == 14)
-        #define USBD_EndPoint14                USBD_HID_EP_INT_Event
+        #define USBD_EndPoint14                USBD_HID_EP_INOUT_Event
       #elif  (USBD_HID_EP_INTIN == 15)
-        #define USBD_EndPoint15                USBD_HID_EP_INT_Event
+        #define USBD_EndPoint15                USBD_HID_EP_INOUT_Event
       #endif
     #else
       #if    (USBD_HID_EP_INTIN == 1)
@@ -876,6 +887,78 @@ const   U16  usbd_cdc_acm_maxpacketsize1[2] = {USBD_CDC_ACM_WMAXPACKETSIZE1, USB
   BOOL USBD_EndPoint0_Out_CDC_ReqToIF (void)                                        { return (__FALSE); }
 #endif  /* (USBD_CDC_ACM_ENABLE) */
 
+#if    (USBD_BULK_ENABLE)
+  #ifdef __RTX
+  #error "Vendor Bulk Interface is not supported with RTX!"
+  #else
+  extern void USBD_BULK_EP_BULK_Event     (U32 event);
+    #if    (USBD_BULK_EP_BULKIN == 1)
+      #define USBD_EndPoint1                USBD_BULK_EP_BULK_Event
+    #elif  (USBD_BULK_EP_BULKIN == 2)
+      #define USBD_EndPoint2                USBD_BULK_EP_BULK_Event
+    #elif  (USBD_BULK_EP_BULKIN == 3)
+      #define USBD_EndPoint3                USBD_BULK_EP_BULK_Event
+    #elif  (USBD_BULK_EP_BULKIN == 4)
+      #define USBD_EndPoint4                USBD_BULK_EP_BULK_Event
+    #elif  (USBD_BULK_EP_BULKIN == 5)
+      #define USBD_EndPoint5                USBD_BULK_EP_BULK_Event
+    #elif  (USBD_BULK_EP_BULKIN == 6)
+      #define USBD_EndPoint6                USBD_BULK_EP_BULK_Event
+    #elif  (USBD_BULK_EP_BULKIN == 7)
+      #define USBD_EndPoint7                USBD_BULK_EP_BULK_Event
+    #elif  (USBD_BULK_EP_BULKIN == 8)
+      #define USBD_EndPoint8                USBD_BULK_EP_BULK_Event
+    #elif  (USBD_BULK_EP_BULKIN == 9)
+      #define USBD_EndPoint9                USBD_BULK_EP_BULK_Event
+    #elif  (USBD_BULK_EP_BULKIN == 10)
+      #define USBD_EndPoint10               USBD_BULK_EP_BULK_Event
+    #elif  (USBD_BULK_EP_BULKIN == 11)
+      #define USBD_EndPoint11               USBD_BULK_EP_BULK_Event
+    #elif  (USBD_BULK_EP_BULKIN == 12)
+      #define USBD_EndPoint12               USBD_BULK_EP_BULK_Event
+    #elif  (USBD_BULK_EP_BULKIN == 13)
+      #define USBD_EndPoint13               USBD_BULK_EP_BULK_Event
+    #elif  (USBD_BULK_EP_BULKIN == 14)
+      #define USBD_EndPoint14               USBD_BULK_EP_BULK_Event
+    #elif  (USBD_BULK_EP_BULKIN == 15)
+      #define USBD_EndPoint15               USBD_BULK_EP_BULK_Event
+    #endif
+    #if    (USBD_BULK_EP_BULKOUT != USBD_BULK_EP_BULKIN)
+      #if    (USBD_BULK_EP_BULKOUT == 1)
+        #define USBD_EndPoint1              USBD_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 2)
+        #define USBD_EndPoint2              USBD_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 3)
+        #define USBD_EndPoint3              USBD_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 4)
+        #define USBD_EndPoint4              USBD_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 5)
+        #define USBD_EndPoint5              USBD_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 6)
+        #define USBD_EndPoint6              USBD_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 7)
+        #define USBD_EndPoint7              USBD_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 8)
+        #define USBD_EndPoint8              USBD_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 9)
+        #define USBD_EndPoint9              USBD_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 10)
+        #define USBD_EndPoint10             USBD_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 11)
+        #define USBD_EndPoint11             USBD_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 12)
+        #define USBD_EndPoint12             USBD_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 13)
+        #define USBD_EndPoint13             USBD_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 14)
+        #define USBD_EndPoint14             USBD_BULK_EP_BULK_Event
+      #elif  (USBD_BULK_EP_BULKOUT == 15)
+        #define USBD_EndPoint15             USBD_BULK_EP_BULK_Event
+      #endif
+    #endif
+  #endif
+#endif  /* (USBD_BULK_ENABLE) */
+
 #if    (USBD_CLS_ENABLE)
 #else
   BOOL USBD_EndPoint0_Setup_CLS_ReqToDEV  (void)                                        { return (__FALSE); }
@@ -1203,13 +1286,15 @@ void USBD_RTX_TaskInit (void) {
 #define USBD_HID_DESC_LEN                 (USB_INTERFACE_DESC_SIZE + USB_HID_DESC_SIZE                                                          + \
                                           (USB_ENDPOINT_DESC_SIZE*(1+(USBD_HID_EP_INTOUT != 0))))
 #define USBD_MSC_DESC_LEN                 (USB_INTERFACE_DESC_SIZE + 2*USB_ENDPOINT_DESC_SIZE)
+#define USBD_BULK_DESC_LEN                (USB_INTERFACE_DESC_SIZE + 2*USB_ENDPOINT_DESC_SIZE)
 #define USBD_HID_DESC_OFS                 (USB_CONFIGUARTION_DESC_SIZE + USB_INTERFACE_DESC_SIZE                                                + \
                                            USBD_CDC_ACM_ENABLE * USBD_CDC_ACM_DESC_LEN)
 
 #define USBD_WTOTALLENGTH                 (USB_CONFIGUARTION_DESC_SIZE +                 \
                                            USBD_CDC_ACM_DESC_LEN * USBD_CDC_ACM_ENABLE + \
                                            USBD_HID_DESC_LEN     * USBD_HID_ENABLE     + \
-                                           USBD_MSC_DESC_LEN     * USBD_MSC_ENABLE)
+                                           USBD_MSC_DESC_LEN     * USBD_MSC_ENABLE     + \
+                                           USBD_BULK_DESC_LEN    * USBD_BULK_ENABLE)
 
 /*------------------------------------------------------------------------------
   Default HID Report Descriptor
@@ -1408,6 +1493,35 @@ const U8 USBD_DeviceQualifier_HS[] = { 0 };
   WBVAL(USBD_HID_HS_WMAXPACKETSIZE),    /* wMaxPacketSize */                                                \
   USBD_HID_HS_BINTERVAL,                /* bInterval */
 
+#define BULK_DESC                                                                                           \
+/* Interface, Alternate Setting 0, Vendor Specific Class */                                                 \
+  USB_INTERFACE_DESC_SIZE,              /* bLength */                                                       \
+  USB_INTERFACE_DESCRIPTOR_TYPE,        /* bDescriptorType */                                               \
+  USBD_BULK_IF_NUM,                     /* bInterfaceNumber */                                              \
+  0x00,                                 /* bAlternateSetting */                                             \
+  0x02,                                 /* bNumEndpoints */                                                 \
+  0xFF,                                 /* bInterfaceClass: Vendor Specific */                              \
+  0x00,                                 /* bInterfaceSubClass */                                            \
+  0x00,                                 /* bInterfaceProtocol */                                            \
+  USBD_BULK_IF_STR_NUM,                 /* iInterface */
+
+#define BULK_EP                         /* Vendor Bulk Endpoints (Bulk Out first for CMSIS-DAP v2) */       \
+/* Endpoint, EP Bulk OUT */                                                                                 \
+  USB_ENDPOINT_DESC_SIZE,               /* bLength */                                                       \
+  USB_ENDPOINT_DESCRIPTOR_TYPE,         /* bDescriptorType */                                               \
+  USB_ENDPOINT_OUT(USBD_BULK_EP_BULKOUT),/* bEndpointAddress */                                             \
+  USB_ENDPOINT_TYPE_BULK,               /* bmAttributes */                                                  \
+  WBVAL(USBD_BULK_WMAXPACKETSIZE),      /* wMaxPacketSize */                                                \
+  0x00,                                 /* bInterval: ignore for Bulk transfer */                           \
+                                                                                                            \
+/* Endpoint, EP Bulk IN */                                                                                  \
+  USB_ENDPOINT_DESC_SIZE,               /* bLength */                                                       \
+  USB_ENDPOINT_DESCRIPTOR_TYPE,         /* bDescriptorType */                                               \
+  USB_ENDPOINT_IN(USBD_BULK_EP_BULKIN), /* bEndpointAddress */                                              \
+  USB_ENDPOINT_TYPE_BULK,               /* bmAttributes */                                                  \
+  WBVAL(USBD_BULK_WMAXPACKETSIZE),      /* wMaxPacketSize */                                                \
+  0x00,                                 /* bInterval: ignore for Bulk transfer */
+
 #define MSC_DESC                                                                                            \
 /* Interface, Alternate Setting 0, MSC Class */                                                             \
   USB_INTERFACE_DESC_SIZE,              /* bLength */                                                       \
@@ -1758,6 +1872,11 @@ const U8 USBD_ConfigDescriptor[] = {
 #endif
 #endif
 
+#if (USBD_BULK_ENABLE)
+  BULK_DESC
+  BULK_EP
+#endif
+
 
 /* Terminator */                                                                                            \
   0                                     /* bLength */                                                       \
@@ -1814,6 +1933,11 @@ const U8 USBD_ConfigDescriptor_HS[] = {
 #endif
 #endif
 
+#if (USBD_BULK_ENABLE)
+  BULK_DESC
+  BULK_EP
+#endif
+
 #if (USBD_MSC_ENABLE)
   MSC_DESC
   MSC_EP_HS
@@ -1865,6 +1989,11 @@ const U8 USBD_OtherSpeedConfigDescriptor[] = {
 #endif
 #endif
 
+#if (USBD_BULK_ENABLE)
+  BULK_DESC
+  BULK_EP
+#endif
+
 #if (USBD_MSC_ENABLE)
   MSC_DESC
   MSC_EP_HS
@@ -1916,6 +2045,11 @@ const U8 USBD_OtherSpeedConfigDescriptor_HS[] = {
 #endif
 #endif
 
+#if (USBD_BULK_ENABLE)
+  BULK_DESC
+  BULK_EP
+#endif
+
 #if (USBD_MSC_ENABLE)
   MSC_DESC
   MSC_EP
@@ -1964,6 +2098,9 @@ const struct {
 #if (USBD_MSC_ENABLE)
   USBD_STR_DEF(MSC_STRDESC);
 #endif
+#if (USBD_BULK_ENABLE)
+  USBD_STR_DEF(BULK_STRDESC);
+#endif
 } USBD_StringDescriptor
   =
 {
@@ -1988,6 +2125,9 @@ const struct {
 #if (USBD_MSC_ENABLE)
   USBD_STR_VAL(MSC_STRDESC),
 #endif
+#if (USBD_BULK_ENABLE)
+  USBD_STR_VAL(BULK_STRDESC),
+#endif
 };
 
 #endif
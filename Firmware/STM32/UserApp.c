@@ -6,12 +6,16 @@
 
 void UserAppInit(CoreDescriptor_t *core);
 void UserAppAbort(void);
+uint32_t UserAppIdle(uint8_t *report);
+uint32_t UserAppBusy(void);
 
 __attribute__((section("USERINIT")))
 const UserAppDescriptor_t UserAppDescriptor = {
 	&UserAppInit,
 	&DAP_ProcessCommand,
-	&UserAppAbort
+	&UserAppAbort,
+	&UserAppIdle,
+	&UserAppBusy
 };
 
 CoreDescriptor_t * pCoreDescriptor;
@@ -27,8 +31,38 @@ void UserAppAbort(void)
 	DAP_TransferAbort = 1;
 }
 
+uint32_t UserAppIdle(uint8_t *report)
+{
+#if (DAP_SWO != 0)
+	SWO_UART_Count();	// Poll trace DMA for overrun
+#endif
+#if (DAP_VENDOR_COMMANDS != 0)
+	return DAP_ProcessVendorIdle(report);
+#else
+	return 0;
+#endif
+}
+
+uint32_t UserAppBusy(void)
+{
+#if (DAP_VENDOR_COMMANDS != 0)
+	return DAP_ProcessVendorBusy();
+#else
+	return 0;
+#endif
+}
+
 #include "..\DAP.c"
 #include "..\SW_DP.c"
 #include "..\JTAG_DP.c"
+#include "SWJ_DMA.c"
+#include "SWO_UART.c"
+#include "MEM_AP.c"
+#include "SWD_Gang.c"
+#include "DAP_monitor.c"
+#include "DAP_profile.c"
+#include "DAP_sample.c"
+#include "DAP_rtt.c"
+#include "DAP_vendor.c"
 
 #endif
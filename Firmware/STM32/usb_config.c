@@ -83,7 +83,7 @@
 //       <i> Device release number in binary-coded decimal (bcdDevice)
 //   </h>
 #define USBD_POWER                  0
-#define USBD_MAX_PACKET0            64
+#define USBD_MAX_PACKET0            32
 #define USBD_DEVDESC_IDVENDOR       0xC251
 #define USBD_DEVDESC_IDPRODUCT      0xF001
 #define USBD_DEVDESC_BCDDEVICE      0x0100
@@ -159,6 +159,8 @@
 //         <o10.0..15> Maximum Input Report Size (in bytes) <1-65535>
 //         <o11.0..15> Maximum Output Report Size (in bytes) <1-65535>
 //         <o12.0..15> Maximum Feature Report Size (in bytes) <1-65535>
+//         <q13> Direct Endpoint Access
+//           <i> Interrupt Endpoint data is read into and sent from the application packet buffers
 //       </h>
 //     </e>
 #define USBD_HID_ENABLE             1
@@ -175,6 +177,7 @@
 #define USBD_HID_INREPORT_MAX_SZ    64
 #define USBD_HID_OUTREPORT_MAX_SZ   64
 #define USBD_HID_FEATREPORT_MAX_SZ  1
+#define USBD_HID_EP_DIRECT          1
 
 //     <e0.0> Mass Storage Device (MSC)
 //       <i> Enable class support for Mass Storage Device (MSC)
@@ -319,7 +322,7 @@
 //     </e>
 #define USBD_CDC_ACM_ENABLE             1
 #define USBD_CDC_ACM_EP_INTIN           1
-#define USBD_CDC_ACM_WMAXPACKETSIZE     64
+#define USBD_CDC_ACM_WMAXPACKETSIZE     16
 #define USBD_CDC_ACM_BINTERVAL          2
 #define USBD_CDC_ACM_HS_ENABLE          0
 #define USBD_CDC_ACM_HS_WMAXPACKETSIZE  16
@@ -332,7 +335,7 @@
 #define USBD_CDC_ACM_HS_BINTERVAL1      0
 #define USBD_CDC_ACM_CIF_STRDESC        L"CMSIS-DAP CDC"
 #define USBD_CDC_ACM_DIF_STRDESC        L"CMSIS-DAP DCI"
-#define USBD_CDC_ACM_SENDBUF_SIZE       64
+#define USBD_CDC_ACM_SENDBUF_SIZE       256
 #define USBD_CDC_ACM_RECEIVEBUF_SIZE    64
 
 #if (((USBD_CDC_ACM_HS_ENABLE1) && (USBD_CDC_ACM_SENDBUF_SIZE    < USBD_CDC_ACM_HS_WMAXPACKETSIZE1)) || (USBD_CDC_ACM_SENDBUF_SIZE    < USBD_CDC_ACM_WMAXPACKETSIZE1))
@@ -343,6 +346,34 @@
 	#error "Receive Buffer size must be larger or equal to Bulk Out maximum packet size!"
 #endif
 
+//     <e0> Vendor Bulk Interface (CMSIS-DAP v2)
+//       <i> Enable vendor specific interface with bulk endpoints for CMSIS-DAP commands
+//       <i> Requests and responses are processed like HID reports but have variable length
+//       <h> Bulk Endpoint Settings
+//         <o1.0..4> Bulk In Endpoint Number                  <1=>   1 <2=>   2 <3=>   3
+//                                            <4=>   4        <5=>   5 <6=>   6 <7=>   7
+//                                            <8=>   8        <9=>   9 <10=> 10 <11=> 11
+//                                            <12=>  12       <13=> 13 <14=> 14 <15=> 15
+//         <o2.0..4> Bulk Out Endpoint Number                 <1=>   1 <2=>   2 <3=>   3
+//                                            <4=>   4        <5=>   5 <6=>   6 <7=>   7
+//                                            <8=>   8        <9=>   9 <10=> 10 <11=> 11
+//                                            <12=>  12       <13=> 13 <14=> 14 <15=> 15
+//           <i> Bulk In and Bulk Out can use the same endpoint number unless Bulk Out is double buffered
+//         <h> Endpoint Settings
+//           <o3> Maximum Packet Size <8=> 8 <16=> 16 <32=> 32 <64=> 64
+//         </h>
+//       </h>
+//       <h> Vendor Bulk Interface Settings
+//         <s0.126> Bulk Interface String
+//           <i> Must contain "CMSIS-DAP" to be detected by debuggers
+//       </h>
+//     </e>
+#define USBD_BULK_ENABLE            1
+#define USBD_BULK_EP_BULKIN         4
+#define USBD_BULK_EP_BULKOUT        4
+#define USBD_BULK_WMAXPACKETSIZE    64
+#define USBD_BULK_STRDESC           L"CMSIS-DAP v2"
+
 //     <e0> Custom Class Device
 //       <i> Enables USB Custom Class Requests
 //       <i> Class IDs:
@@ -367,7 +398,7 @@
 
 /* USB Device Calculations ---------------------------------------------------*/
 
-#define USBD_IF_NUM                (USBD_HID_ENABLE+USBD_MSC_ENABLE+(USBD_ADC_ENABLE*2)+(USBD_CDC_ACM_ENABLE*2)+USBD_CLS_ENABLE)
+#define USBD_IF_NUM                (USBD_HID_ENABLE+USBD_MSC_ENABLE+(USBD_ADC_ENABLE*2)+(USBD_CDC_ACM_ENABLE*2)+USBD_BULK_ENABLE+USBD_CLS_ENABLE)
 #define USBD_MULTI_IF              (USBD_CDC_ACM_ENABLE*(USBD_HID_ENABLE|USBD_MSC_ENABLE|USBD_ADC_ENABLE))
 #define MAX(x, y)                (((x) < (y)) ? (y) : (x))
 #define USBD_EP_NUM_CALC0           MAX((USBD_HID_ENABLE    *(USBD_HID_EP_INTIN     )), (USBD_HID_ENABLE    *(USBD_HID_EP_INTOUT!=0)*(USBD_HID_EP_INTOUT)))
@@ -377,7 +408,9 @@
 #define USBD_EP_NUM_CALC4           MAX(USBD_EP_NUM_CALC0, USBD_EP_NUM_CALC1)
 #define USBD_EP_NUM_CALC5           MAX(USBD_EP_NUM_CALC2, USBD_EP_NUM_CALC3)
 #define USBD_EP_NUM_CALC6           MAX(USBD_EP_NUM_CALC4, USBD_EP_NUM_CALC5)
-#define USBD_EP_NUM                (USBD_EP_NUM_CALC6)
+#define USBD_EP_NUM_CALC7           MAX((USBD_BULK_ENABLE   *(USBD_BULK_EP_BULKIN   )), (USBD_BULK_ENABLE   *(USBD_BULK_EP_BULKOUT)))
+#define USBD_EP_NUM_CALC8           MAX(USBD_EP_NUM_CALC6, USBD_EP_NUM_CALC7)
+#define USBD_EP_NUM                (USBD_EP_NUM_CALC8)
 
 #if	(USBD_HID_ENABLE)
 #if	(USBD_MSC_ENABLE)
@@ -441,6 +474,26 @@
 #endif
 #endif
 
+#if	(USBD_BULK_ENABLE)
+#define USBD_BULK_USES_EP(n)	((USBD_BULK_EP_BULKIN == (n)) || (USBD_BULK_EP_BULKOUT == (n)))
+#if	((USBD_HID_ENABLE)									&& \
+	(USBD_BULK_USES_EP(USBD_HID_EP_INTIN)				|| \
+	USBD_BULK_USES_EP(USBD_HID_EP_INTOUT)))
+	#error "HID and Vendor Bulk Interface can not use same Endpoints!"
+#endif
+#if	((USBD_CDC_ACM_ENABLE)								&& \
+	(USBD_BULK_USES_EP(USBD_CDC_ACM_EP_INTIN)			|| \
+	USBD_BULK_USES_EP(USBD_CDC_ACM_EP_BULKIN)			|| \
+	USBD_BULK_USES_EP(USBD_CDC_ACM_EP_BULKOUT)))
+	#error "Communication Device and Vendor Bulk Interface can not use same Endpoints!"
+#endif
+#if	((USBD_MSC_ENABLE)									&& \
+	(USBD_BULK_USES_EP(USBD_MSC_EP_BULKIN)				|| \
+	USBD_BULK_USES_EP(USBD_MSC_EP_BULKOUT)))
+	#error "Mass Storage Device and Vendor Bulk Interface can not use same Endpoints!"
+#endif
+#endif
+
 #define USBD_ADC_CIF_NUM           (0)
 #define USBD_ADC_SIF1_NUM          (1)
 #define USBD_ADC_SIF2_NUM          (2)
@@ -448,6 +501,7 @@
 #define USBD_CDC_ACM_DIF_NUM       (USBD_ADC_ENABLE * 2 + 1)
 #define USBD_HID_IF_NUM            (USBD_ADC_ENABLE * 2 + USBD_CDC_ACM_ENABLE * 2)
 #define USBD_MSC_IF_NUM            (USBD_ADC_ENABLE * 2 + USBD_CDC_ACM_ENABLE * 2 + USBD_HID_ENABLE)
+#define USBD_BULK_IF_NUM           (USBD_ADC_ENABLE * 2 + USBD_CDC_ACM_ENABLE * 2 + USBD_HID_ENABLE + USBD_MSC_ENABLE)
 
 #define USBD_ADC_CIF_STR_NUM       (3 + USBD_STRDESC_SER_ENABLE + 0)
 #define USBD_ADC_SIF1_STR_NUM      (3 + USBD_STRDESC_SER_ENABLE + 1)
@@ -456,6 +510,7 @@
 #define USBD_CDC_ACM_DIF_STR_NUM   (3 + USBD_STRDESC_SER_ENABLE + USBD_ADC_ENABLE * 3 + 1)
 #define USBD_HID_IF_STR_NUM        (3 + USBD_STRDESC_SER_ENABLE + USBD_ADC_ENABLE * 3 + USBD_CDC_ACM_ENABLE * 2)
 #define USBD_MSC_IF_STR_NUM        (3 + USBD_STRDESC_SER_ENABLE + USBD_ADC_ENABLE * 3 + USBD_CDC_ACM_ENABLE * 2 + USBD_HID_ENABLE)
+#define USBD_BULK_IF_STR_NUM       (3 + USBD_STRDESC_SER_ENABLE + USBD_ADC_ENABLE * 3 + USBD_CDC_ACM_ENABLE * 2 + USBD_HID_ENABLE + USBD_MSC_ENABLE)
 
 #if    (USBD_HID_ENABLE)
 #if    (USBD_HID_HS_ENABLE)
@@ -9,7 +9,7 @@
  *	  Copyright (c) 2004-2013 KEIL - An ARM Company. All rights reserved.
  *---------------------------------------------------------------------------*/
 
-/* Double Buffering is not yet supported									  */
+/* Double Buffering is supported for Bulk OUT Endpoints only				  */
 
 #define __STM32
 
@@ -23,9 +23,21 @@
 #define __NO_USB_LIB_C
 #include "usb_config.c"
 
+/* Double buffered Bulk OUT Endpoints (bit n = Endpoint n)					*/
+/*	Both buffer descriptors of the endpoint are used for reception: the host	*/
+/*	can send the next packet while the previous one is read by the software.	*/
+/*	None by default: the second buffer does not fit into packet memory with	*/
+/*	64 byte CDC bulk endpoints. The single buffered vendor Bulk OUT NAKs the	*/
+/*	host while the request ring is full (USB_RequestRead) and loses nothing.	*/
 #define USB_DBL_BUF_EP	0x0000
+#if ((USBD_BULK_ENABLE) && (USB_DBL_BUF_EP & (1 << USBD_BULK_EP_BULKIN)))
+	#error "Double buffered Bulk Out Endpoint can not be used for Bulk In!"
+#endif
+
+#define EP_DBL_BUF_OUT(EPNum)	(!((EPNum) & 0x80) && (USB_DBL_BUF_EP & (1 << ((EPNum) & 0x0F))))
 
-#define EP_BUF_ADDR		(sizeof(EP_BUF_DSCR) * (USBD_EP_NUM + 1))	/* Endpoint Buf Adr */
+/* Buffer descriptor table uses 4 half-words of packet memory per endpoint	*/
+#define EP_BUF_ADDR		(8 * (USBD_EP_NUM + 1))	/* Endpoint Buf Adr */
 // Ptr to EP Buf Desc
 EP_BUF_DSCR *pBUF_DSCR = (EP_BUF_DSCR *)USB_PMA_ADDR;
 // Endpoint Free Buffer Address
@@ -49,6 +61,10 @@ void EP_Reset (U32 EPNum)
 	{	// IN Endpoint
 		EPxREG(num) = val & (EP_MASK | EP_DTOG_TX);
 	}
+	else if (EP_DBL_BUF_OUT(EPNum))
+	{	// Double buffered OUT Endpoint: DTOG_RX = 0, SW_BUF (DTOG_TX) = 1
+		EPxREG(num) = (val & (EP_MASK | EP_DTOG_RX | EP_DTOG_TX)) ^ EP_DTOG_TX;
+	}
 	else
 	{	// OUT Endpoint
 		EPxREG(num) = val & (EP_MASK | EP_DTOG_RX);
@@ -139,7 +155,6 @@ void USBD_Connect (BOOL con)
  */
 void USBD_Reset (void)
 {
-	/* Double Buffering is not yet supported	*/
 
 	ISTR = 0;	/* Clear Interrupt Status		*/
 
@@ -256,8 +271,8 @@ void USBD_Configure (BOOL cfg)
  */
 void USBD_ConfigEP (USB_ENDPOINT_DESCRIPTOR *pEPD)
 {
-	/* Double Buffering is not yet supported									*/
-	U32 num, val;
+	/* Double Buffering is supported for Bulk OUT Endpoints only				*/
+	U32 num, val, cnt;
 
 	num = pEPD->bEndpointAddress & 0x0F;
 
@@ -269,17 +284,24 @@ void USBD_ConfigEP (USB_ENDPOINT_DESCRIPTOR *pEPD)
 	}
 	else
 	{
-		(pBUF_DSCR + num)->ADDR_RX = FreeBufAddr;
 		if (val > 62)
 		{
 			val = (val + 31) & ~31;
-			(pBUF_DSCR + num)->COUNT_RX = ((val << 5) - 1) | 0x8000;
+			cnt = ((val << 5) - 1) | 0x8000;
 		}
 		else
 		{
 			val = (val + 1)  & ~1;
-			(pBUF_DSCR + num)->COUNT_RX =	val << 9;
+			cnt = val << 9;
 		}
+		if (EP_DBL_BUF_OUT(pEPD->bEndpointAddress))
+		{	/* Buffer 0 uses TX descriptor, buffer 1 RX descriptor		*/
+			(pBUF_DSCR + num)->ADDR_TX  = FreeBufAddr;
+			(pBUF_DSCR + num)->COUNT_TX = cnt;
+			FreeBufAddr += val;
+		}
+		(pBUF_DSCR + num)->ADDR_RX  = FreeBufAddr;
+		(pBUF_DSCR + num)->COUNT_RX = cnt;
 	}
 	FreeBufAddr += val;
 
@@ -293,9 +315,9 @@ void USBD_ConfigEP (USB_ENDPOINT_DESCRIPTOR *pEPD)
 		break;
 	case USB_ENDPOINT_TYPE_BULK:
 		val = EP_BULK;
-		if (USB_DBL_BUF_EP & (1 << num))
+		if (EP_DBL_BUF_OUT(pEPD->bEndpointAddress))
 		{
-			val |= EP_KIND;
+			val |= EP_DBL_BUF;
 		}
 		break;
 	case USB_ENDPOINT_TYPE_INTERRUPT:
@@ -304,6 +326,10 @@ void USBD_ConfigEP (USB_ENDPOINT_DESCRIPTOR *pEPD)
 	}
 	val |= num;
 	EPxREG(num) = val;
+	if (EP_DBL_BUF_OUT(pEPD->bEndpointAddress))
+	{	/* Hardware fills buffer 0 first		*/
+		EP_Reset(pEPD->bEndpointAddress);
+	}
 }
 
 /*
@@ -402,11 +428,32 @@ void USBD_ClearEPBuf (U32 EPNum)
  */
 U32 USBD_ReadEP (U32 EPNum, U8 *pData)
 {
-	/* Double Buffering is not yet supported	*/
-	U32 num, cnt, *pv, n;
+	U32 num, cnt, *pv, n, val;
 
 	num = EPNum & 0x0F;
 
+	if (EP_DBL_BUF_OUT(EPNum))
+	{	/* Toggle SW_BUF first: the other buffer can be filled while this one is read */
+		val = EPxREG(num);
+		EPxREG(num) = (val & EP_MASK) | EP_CTR_RX | EP_CTR_TX | EP_DTOG_TX;
+		if (val & EP_DTOG_TX)
+		{	/* Buffer 0	*/
+			pv  = (U32 *)(USB_PMA_ADDR + 2 * ((pBUF_DSCR + num)->ADDR_TX));
+			cnt = (pBUF_DSCR + num)->COUNT_TX & EP_COUNT_MASK;
+		}
+		else
+		{	/* Buffer 1	*/
+			pv  = (U32 *)(USB_PMA_ADDR + 2 * ((pBUF_DSCR + num)->ADDR_RX));
+			cnt = (pBUF_DSCR + num)->COUNT_RX & EP_COUNT_MASK;
+		}
+		for (n = 0; n < (cnt + 1) / 2; n++)
+		{
+			*((__packed U16 *)pData) = *pv++;
+			pData += 2;
+		}
+		return (cnt);
+	}
+
 	pv  = (U32 *)(USB_PMA_ADDR + 2 * ((pBUF_DSCR + num)->ADDR_RX));
 	cnt = (pBUF_DSCR + num)->COUNT_RX & EP_COUNT_MASK;
 	for (n = 0; n < (cnt + 1) / 2; n++)
@@ -419,6 +466,40 @@ U32 USBD_ReadEP (U32 EPNum, U8 *pData)
 	return (cnt);
 }
 
+/*
+ *  Get first byte of USB Device Endpoint Data without reading the packet
+ *	Parameters:		EPNum: Device Endpoint Number
+ *						EPNum.0..3: Address
+ *						EPNum.7:	Dir
+ *	Return Value:	First byte of the packet USBD_ReadEP reads next,
+ *					0xFFFFFFFF if the packet is empty
+ */
+U32 USBD_PeekEP (U32 EPNum)
+{
+	U32 num, cnt, *pv;
+
+	num = EPNum & 0x0F;
+
+	if (EP_DBL_BUF_OUT(EPNum) && ((EPxREG(num) & EP_DTOG_TX) == 0))
+	{	/* Buffer 1	*/
+		pv  = (U32 *)(USB_PMA_ADDR + 2 * ((pBUF_DSCR + num)->ADDR_RX));
+		cnt = (pBUF_DSCR + num)->COUNT_RX & EP_COUNT_MASK;
+	}
+	else if (EP_DBL_BUF_OUT(EPNum))
+	{	/* Buffer 0	*/
+		pv  = (U32 *)(USB_PMA_ADDR + 2 * ((pBUF_DSCR + num)->ADDR_TX));
+		cnt = (pBUF_DSCR + num)->COUNT_TX & EP_COUNT_MASK;
+	}
+	else
+	{
+		pv  = (U32 *)(USB_PMA_ADDR + 2 * ((pBUF_DSCR + num)->ADDR_RX));
+		cnt = (pBUF_DSCR + num)->COUNT_RX & EP_COUNT_MASK;
+	}
+	if (cnt == 0)
+		return (0xFFFFFFFF);
+	return (*pv & 0xFF);
+}
+
 /*
  *  Write USB Device Endpoint Data
  *	Parameters:	  EPNum: Device Endpoint Number
@@ -431,7 +512,7 @@ U32 USBD_ReadEP (U32 EPNum, U8 *pData)
 
 U32 USBD_WriteEP (U32 EPNum, U8 *pData, U32 cnt)
 {
-	/* Double Buffering is not yet supported									*/
+	/* Double Buffering is not supported for IN Endpoints						*/
 	U32 num, *pv, n;
 	U16 statusEP;
 
@@ -9,21 +9,175 @@
 
 #include "DAP_Config.h"
 #include "usbd_user_cdc_acm.h"
+#include "Ring.h"
 
+#if ((USART_BUFFER_SIZE & (USART_BUFFER_SIZE - 1)) != 0)
+	#error "USART_BUFFER_SIZE must be 2^n"
+#endif
+#if ((USART_RX_BUFFER_SIZE & (USART_RX_BUFFER_SIZE - 1)) != 0)
+	#error "USART_RX_BUFFER_SIZE must be 2^n"
+#endif
+
+#define USART_SLOT(index)		RING_SLOT(index, USART_BUFFER_SIZE)
+#define USART_RX_SLOT(index)	RING_SLOT(index, USART_RX_BUFFER_SIZE)
+
+// WrBuffer: USB -> USART TX DMA
+//   A DMA transfer sends the contiguous data from the out index, the next one
+//   is started by its transfer complete interrupt.
 static struct {
-	volatile uint16_t	idx_in;
-	volatile uint16_t	idx_out;
-	volatile int16_t	cnt_in;
-	volatile int16_t	cnt_out;
-			uint8_t		data[USART_BUFFER_SIZE];
-} WrBuffer, RdBuffer;
+	RING		ring;
+	uint8_t		data[USART_BUFFER_SIZE];
+} WrBuffer;
+
+// RdBuffer: USART RX DMA (circular) -> USB
+//   The in index follows the DMA position on half transfer, transfer complete
+//   and idle line interrupts; the same interrupts move the received bytes into
+//   the CDC send buffer (UART_RxSend), so the bridge does not depend on the
+//   main loop (long DAP commands).
+static struct {
+	RING		ring;
+	uint8_t		data[USART_RX_BUFFER_SIZE];
+} RdBuffer;
+
+static volatile uint32_t TxLength;		// Bytes of running TX DMA transfer (0 = idle)
+static volatile uint32_t RxOverrun;		// Receive DMA has overwritten unread data
+static volatile uint32_t RxBridge = 1;	// Received data is sent by the interrupts
 
 static USART_InitTypeDef UART_Config;
 static uint32_t StatusRegister;
-static uint32_t SendBreakFlag;
 static uint32_t BreakFlag;
 static CDC_LINE_CODING line_coding_current;
 
+/*------------------------------------------------------------------------------
+ * UART_DmaStart:  Start receive DMA (circular) and enable transmit DMA
+ *----------------------------------------------------------------------------*/
+static void UART_DmaStart(void)
+{
+	RCC->AHBENR |= RCC_AHBENR_DMA1EN;
+
+	USART_DMA_RX->CCR = 0;
+	USART_DMA_TX->CCR = 0;
+	Ring_Init(&RdBuffer.ring);
+	Ring_Init(&WrBuffer.ring);
+	TxLength  = 0;
+	RxOverrun = 0;
+
+	DMA1->IFCR = USART_DMA_RX_CLEAR | USART_DMA_TX_CLEAR;
+	USART_DMA_RX->CPAR  = (uint32_t)&USART_PORT->DR;
+	USART_DMA_RX->CMAR  = (uint32_t)RdBuffer.data;
+	USART_DMA_RX->CNDTR = USART_RX_BUFFER_SIZE;
+	USART_DMA_RX->CCR   = DMA_CCR1_PL_1 | DMA_CCR1_MINC | DMA_CCR1_CIRC |
+						  DMA_CCR1_HTIE | DMA_CCR1_TCIE | DMA_CCR1_EN;
+	USART_DMA_TX->CPAR  = (uint32_t)&USART_PORT->DR;
+
+	USART_PORT->CR3 |= USART_CR3_DMAR | USART_CR3_DMAT;
+	// Receive interrupts call USBD_CDC_ACM_DataSend: same priority as the USB
+	// interrupt, so they never preempt the CDC send buffer handling
+	NVIC_SetPriority(USART_IRQn,        NVIC_GetPriority(USB_LP_CAN1_RX0_IRQn));
+	NVIC_SetPriority(USART_DMA_RX_IRQn, NVIC_GetPriority(USB_LP_CAN1_RX0_IRQn));
+	NVIC_EnableIRQ(USART_DMA_RX_IRQn);
+	NVIC_EnableIRQ(USART_DMA_TX_IRQn);
+}
+
+/*------------------------------------------------------------------------------
+ * UART_DmaStop:  Stop receive and transmit DMA
+ *----------------------------------------------------------------------------*/
+static void UART_DmaStop(void)
+{
+	NVIC_DisableIRQ(USART_DMA_RX_IRQn);
+	NVIC_DisableIRQ(USART_DMA_TX_IRQn);
+	USART_DMA_RX->CCR = 0;
+	USART_DMA_TX->CCR = 0;
+	TxLength = 0;
+}
+
+/*------------------------------------------------------------------------------
+ * UART_TxStart:  Start TX DMA with buffered data (TX DMA is idle)
+ *----------------------------------------------------------------------------*/
+static void UART_TxStart(void)
+{
+	uint32_t cnt, slot;
+
+	cnt = Ring_Count(&WrBuffer.ring);
+	slot = USART_SLOT(WrBuffer.ring.out);
+	if (cnt > (USART_BUFFER_SIZE - slot))
+		cnt = USART_BUFFER_SIZE - slot;		// Up to end of buffer
+	TxLength = cnt;
+	if (cnt == 0)
+		return;
+
+	USART_DMA_TX->CCR   = 0;
+	USART_DMA_TX->CMAR  = (uint32_t)&WrBuffer.data[slot];
+	USART_DMA_TX->CNDTR = cnt;
+	USART_DMA_TX->CCR   = DMA_CCR1_PL_0 | DMA_CCR1_MINC | DMA_CCR1_DIR | DMA_CCR1_TCIE | DMA_CCR1_EN;
+}
+
+/*------------------------------------------------------------------------------
+ * UART_RxUpdate:  Advance receive in index to DMA position (interrupt only)
+ *----------------------------------------------------------------------------*/
+static void UART_RxUpdate(void)
+{
+	uint32_t pos;
+
+	pos = USART_RX_BUFFER_SIZE - USART_DMA_RX->CNDTR;
+	Ring_Put(&RdBuffer.ring, (pos - USART_RX_SLOT(RdBuffer.ring.in)) & (USART_RX_BUFFER_SIZE - 1));
+}
+
+/*------------------------------------------------------------------------------
+ * UART_RxSend:  Move received data into the CDC send buffer (interrupt only)
+ *   Data stays in RdBuffer while the send buffer is full or the port is
+ *   claimed by the user application.
+ *----------------------------------------------------------------------------*/
+static void UART_RxSend(void)
+{
+	uint32_t cnt, slot, n;
+
+	if (!RxBridge)
+		return;
+	if (Ring_Count(&RdBuffer.ring) >= USART_RX_BUFFER_SIZE)
+	{	// DMA has written a full buffer past the out index: drop all
+		RxOverrun = 1;
+		Ring_Get(&RdBuffer.ring, Ring_Count(&RdBuffer.ring));
+		return;
+	}
+	for (n = 0; n < 2; n++)
+	{	// Up to end of buffer, then from start of buffer
+		cnt  = Ring_Count(&RdBuffer.ring);
+		slot = USART_RX_SLOT(RdBuffer.ring.out);
+		if (cnt > (USART_RX_BUFFER_SIZE - slot))
+			cnt = USART_RX_BUFFER_SIZE - slot;
+		if (cnt == 0)
+			break;
+		cnt = USBD_CDC_ACM_DataSend(&RdBuffer.data[slot], cnt);
+		if (cnt == 0)
+			break;
+		Ring_Get(&RdBuffer.ring, cnt);
+	}
+}
+
+/*------------------------------------------------------------------------------
+ * UART_RxBridge:  Enable or disable sending of received data by the interrupts
+ *   enable: 1 = UART bridge, 0 = port claimed by user application
+ *----------------------------------------------------------------------------*/
+void UART_RxBridge(uint32_t enable)
+{
+	RxBridge = enable;
+	if (enable)
+		NVIC_SetPendingIRQ(USART_DMA_RX_IRQn);	// Send data received meanwhile
+}
+
+/*------------------------------------------------------------------------------
+ * UART_RxFlush:  Retry sending of received data (send buffer was full)
+ *   return: 1 = received data is waiting
+ *----------------------------------------------------------------------------*/
+int32_t UART_RxFlush(void)
+{
+	if (!RxBridge || (Ring_Count(&RdBuffer.ring) == 0))
+		return (0);
+	NVIC_SetPendingIRQ(USART_DMA_RX_IRQn);
+	return (1);
+}
+
 /*------------------------------------------------------------------------------
  * UART_Reset:  Reset the Serial module variables
  *----------------------------------------------------------------------------*/
@@ -32,7 +186,6 @@ int32_t UART_Reset(void)
 {
 	NVIC_DisableIRQ(USART_IRQn);	/* Disable USART interrupt */
 
-	SendBreakFlag    = 0;
 	BreakFlag        = 0;
 
 	line_coding_current.bCharFormat = UART_STOP_BITS_1;
@@ -68,6 +221,7 @@ int32_t USBD_CDC_ACM_PortInitialize (void)
 
 	USART_CLOCK(ENABLE);
 	UART_Reset();
+	UART_DmaStart();
 
 	GPIO_INIT(USART_GPIO, UART_RX_INIT);
 	GPIO_INIT(USART_GPIO, UART_TX_INIT);
@@ -85,6 +239,7 @@ int32_t USBD_CDC_ACM_PortInitialize (void)
  */
 int32_t USBD_CDC_ACM_PortUninitialize (void)
 { 
+	UART_DmaStop();
 	USART_CLOCK(DISABLE);
 	GPIO_INIT(USART_GPIO, UART_RX_DEINIT);
 	GPIO_INIT(USART_GPIO, UART_TX_DEINIT);
@@ -155,7 +310,7 @@ int32_t USBD_CDC_ACM_PortSetLineCoding(CDC_LINE_CODING *line_coding)
 	config->USART_HardwareFlowControl	= USART_HardwareFlowControl_None;
 	
 	USART_Init(USART_PORT, config);
-	USART_ITConfig(USART_PORT, USART_IT_RXNE, ENABLE);
+	USART_ITConfig(USART_PORT, USART_IT_IDLE, ENABLE);
 	USART_Cmd(USART_PORT, ENABLE);
 	return (1);
 }
@@ -201,27 +356,24 @@ int32_t USBD_CDC_ACM_PortSetControlLineState (uint16_t ctrl_bmp)
  *----------------------------------------------------------------------------*/
 int32_t UART_WriteData (uint8_t *data, uint16_t size)
 {
-	int32_t cnt = 0;
-	int16_t len_in_buf;
-	uint16_t next;
+	uint32_t cnt;
+	uint32_t in, n;
 
-	while (size != 0)
-	{
-		--size;
-		len_in_buf = WrBuffer.cnt_in - WrBuffer.cnt_out;
-		if (len_in_buf < USART_BUFFER_SIZE)
-		{
-			next = WrBuffer.idx_in;
-			WrBuffer.data[next] = *data++;
-			next = (next + 1) & (USART_BUFFER_SIZE - 1);
-			WrBuffer.idx_in = next;
-			WrBuffer.cnt_in++;
-			cnt++;
-		}
-	}
+	cnt = Ring_Free(&WrBuffer.ring, USART_BUFFER_SIZE);
+	if (cnt > size)
+		cnt = size;
+	in = WrBuffer.ring.in;
+	for (n = 0; n < cnt; n++)
+		WrBuffer.data[USART_SLOT(in + n)] = *data++;
 
 	if (cnt != 0)
-		USART_ITConfig(USART_PORT, USART_IT_TXE, ENABLE);
+	{
+		Ring_Put(&WrBuffer.ring, cnt);
+		NVIC_DisableIRQ(USART_DMA_TX_IRQn);
+		if (TxLength == 0)
+			UART_TxStart();
+		NVIC_EnableIRQ(USART_DMA_TX_IRQn);
+	}
 
 	return cnt;
 }
@@ -232,20 +384,27 @@ int32_t UART_WriteData (uint8_t *data, uint16_t size)
 
 int32_t UART_ReadData (uint8_t *data, uint16_t size)
 {
-	int32_t cnt = 0;
-
+	uint32_t cnt = 0;
 #if defined ( USART_CLOCK )
-	while (size != 0)
-	{
-		--size;
-		if (RdBuffer.cnt_in != RdBuffer.cnt_out)
-		{
-			*data++ = RdBuffer.data[RdBuffer.idx_out++];
-			RdBuffer.idx_out &= (USART_BUFFER_SIZE - 1);
-			RdBuffer.cnt_out++;
-			cnt++;
-		}
+	uint32_t in, out, n;
+
+	in  = RdBuffer.ring.in;
+	out = RdBuffer.ring.out;
+	cnt = Ring_Count(&RdBuffer.ring);
+	if (cnt > size)
+		cnt = size;
+	for (n = 0; n < cnt; n++)
+		data[n] = RdBuffer.data[USART_RX_SLOT(out + n)];
+
+	// Copied data is valid if DMA has not written a full buffer past it
+	n  = in + ((USART_RX_BUFFER_SIZE - USART_DMA_RX->CNDTR - USART_RX_SLOT(in)) & (USART_RX_BUFFER_SIZE - 1));
+	if ((n - out) >= USART_RX_BUFFER_SIZE)
+	{	// Drop all received data
+		RxOverrun = 1;
+		Ring_Get(&RdBuffer.ring, RdBuffer.ring.in - out);
+		return (0);
 	}
+	Ring_Get(&RdBuffer.ring, cnt);
 #endif
 	return (cnt);
 }
@@ -279,7 +438,7 @@ int32_t UART_PutChar (uint8_t ch)
  *----------------------------------------------------------------------------*/
 int32_t UART_DataAvailable (void)
 {
-	return (RdBuffer.cnt_in - RdBuffer.cnt_out);
+	return (Ring_Count(&RdBuffer.ring));
 }
 
 /*------------------------------------------------------------------------------
@@ -301,8 +460,9 @@ int32_t UART_GetCommunicationErrorStatus (void)
 
 	if (StatusRegister & USART_SR_PE)
 		err |= UART_PARITY_ERROR_Msk;
-	if (StatusRegister & USART_SR_NE)
+	if ((StatusRegister & (USART_SR_NE | USART_SR_ORE)) || RxOverrun)
 		err |= UART_OVERRUN_ERROR_Msk;
+	RxOverrun = 0;					/* Reported once */
 	if (BreakFlag == 0 && (StatusRegister & USART_SR_FE))
 		err |= UART_PARITY_ERROR_Msk;
 
@@ -314,7 +474,6 @@ int32_t UART_GetCommunicationErrorStatus (void)
  *----------------------------------------------------------------------------*/
 int32_t UART_SetBreak (void)
 {
-	SendBreakFlag = 1;				/* Set send break flag and	*/
 	USART_SendBreak(USART_PORT);	/* send 1 break character	*/
 	return (1);
 }
@@ -334,50 +493,39 @@ int32_t UART_GetBreak (void)
 #if defined ( USART_CLOCK )
 void USART_IRQHandler(void)
 {
-	uint8_t  ch;
-	int16_t  len_in_buf;
-
 	StatusRegister = USART_PORT->SR;
 
-	/* Read data register not empty interrupt */
-	if (USART_GetITStatus(USART_PORT, USART_IT_RXNE) != RESET)
+	/* Idle line interrupt: end of received data */
+	if (StatusRegister & USART_SR_IDLE)
 	{
-		len_in_buf = RdBuffer.cnt_in - RdBuffer.cnt_out;
-		if (len_in_buf < USART_BUFFER_SIZE)
-		{
-			ch = (uint8_t)USART_ReceiveData(USART_PORT);
-			RdBuffer.data[RdBuffer.idx_in++] = ch;
-			if ((ch == 0)
-			&&	USART_GetFlagStatus(USART_PORT, USART_SR_FE)	/* framing error */
-				)
-			{	/* break character */
-				BreakFlag = 1;
-			}
-			else
-				BreakFlag = 0;
-			RdBuffer.idx_in &= (USART_BUFFER_SIZE - 1);
-			RdBuffer.cnt_in++;
-		}
+		(void)USART_PORT->DR;		/* SR and DR read clear IDLE */
+		UART_RxUpdate();
+		/* Break character: 0 with framing error */
+		BreakFlag = (StatusRegister & USART_SR_FE) &&
+					(RdBuffer.data[USART_RX_SLOT(RdBuffer.ring.in - 1)] == 0);
+		UART_RxSend();
 	}
+}
 
-	/* Transmit data register empty interrupt */
-	if (USART_GetITStatus(USART_PORT, USART_IT_TXE) != RESET)
-	{
-		if (SendBreakFlag == 1)
-		{
-			USART_SendBreak(USART_PORT);
-		}
-		else if (WrBuffer.cnt_in != WrBuffer.cnt_out)
-		{
-			USART_SendData(USART_PORT, WrBuffer.data[WrBuffer.idx_out++]);
-			WrBuffer.idx_out &= (USART_BUFFER_SIZE - 1);
-			WrBuffer.cnt_out++;
-		}
-		else
-		{
-			USART_ITConfig(USART_PORT, USART_IT_TXE, DISABLE);
-		}
-	}
+/*------------------------------------------------------------------------------
+ * USART_DMA_RX_IRQ:  Receive DMA half transfer and transfer complete
+ *                    (also set pending by UART_RxFlush)
+ *----------------------------------------------------------------------------*/
+void USART_DMA_RX_IRQHandler(void)
+{
+	DMA1->IFCR = USART_DMA_RX_CLEAR;
+	UART_RxUpdate();
+	UART_RxSend();
+}
+
+/*------------------------------------------------------------------------------
+ * USART_DMA_TX_IRQ:  Transmit DMA transfer complete, send next data
+ *----------------------------------------------------------------------------*/
+void USART_DMA_TX_IRQHandler(void)
+{
+	DMA1->IFCR = USART_DMA_TX_CLEAR;
+	Ring_Get(&WrBuffer.ring, TxLength);
+	UART_TxStart();
 }
 #endif
 #endif
@@ -72,5 +72,9 @@ int32_t  UART_GetStatusLineState          (void);
 int32_t  UART_GetBreak                    (void);
 int32_t  UART_GetChar                     (void);
 int32_t  UART_PutChar                     (uint8_t ch);
+int32_t  UART_WriteData                   (uint8_t *data, uint16_t size);
+int32_t  UART_ReadData                    (uint8_t *data, uint16_t size);
+void     UART_RxBridge                    (uint32_t enable);
+int32_t  UART_RxFlush                     (void);
 
 #endif /* __UART_H */
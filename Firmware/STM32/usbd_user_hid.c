@@ -8,6 +8,7 @@
 
 #include "DAP_config.h"
 #include "..\DAP.h"
+#include "Ring.h"
 
 #if (USBD_HID_OUTREPORT_MAX_SZ != DAP_PACKET_SIZE)
 	#error "USB HID Output Report Size must match DAP Packet Size"
@@ -16,97 +17,242 @@
 	#error "USB HID Input Report Size must match DAP Packet Size"
 #endif
 
+#if (!USBD_HID_EP_DIRECT) || (USBD_HID_EP_INTIN != USBD_HID_EP_INTOUT)
+	#error "DAP packets require HID In/Out on one Endpoint handled directly (USBD_HID_EP_DIRECT)"
+#endif
+#if ((DAP_PACKET_COUNT & (DAP_PACKET_COUNT - 1)) != 0)
+	#error "DAP_PACKET_COUNT must be 2^n"
+#endif
+
+#define REQUEST_SLOT(index)		RING_SLOT(index, DAP_PACKET_COUNT)
+#define RESPONSE_SLOT(index)	RING_SLOT(index, DAP_PACKET_COUNT)
+
 extern UserAppDescriptor_t * pUserAppDescriptor;
 
-static volatile uint8_t  USB_RequestFlag;       // Request  Buffer Usage Flag
-static volatile uint32_t USB_RequestIn;         // Request  Buffer In  Index
-static volatile uint32_t USB_RequestOut;        // Request  Buffer Out Index
+U32 USBD_PeekEP (U32 EPNum);
 
+// Requests are put by the USB interrupt and taken by usbd_hid_process,
+// responses are put by usbd_hid_process and taken by the USB interrupt.
+static          RING     USB_RequestRing;       // Request  Buffer Indices
+static          RING     USB_ResponseRing;      // Response Buffer Indices
 static volatile uint8_t  USB_ResponseIdle;      // Response Buffer Idle  Flag
-static volatile uint8_t  USB_ResponseFlag;      // Response Buffer Usage Flag
-static volatile uint32_t USB_ResponseIn;        // Response Buffer In  Index
-static volatile uint32_t USB_ResponseOut;       // Response Buffer Out Index
+static volatile uint8_t  USB_RequestPending;    // OUT Endpoints NAKing while Request Buffer is full
 
+#define USB_PENDING_HID		0x01				// HID  OUT packet left in endpoint buffer
+#define USB_PENDING_BULK	0x02				// Bulk OUT packet left in endpoint buffer
+#define USB_ABORTED_HID		0x10				// HID  packet left is a processed transfer abort
+#define USB_ABORTED_BULK	0x20				// Bulk packet left is a processed transfer abort
+
+// Endpoint data is read into the request buffer and sent from the response
+// buffer, the HID class report buffers are not used for DAP packets.
 static          uint8_t  USB_Request [DAP_PACKET_COUNT][DAP_PACKET_SIZE];  // Request  Buffer
 static          uint8_t  USB_Response[DAP_PACKET_COUNT][DAP_PACKET_SIZE];  // Response Buffer
+static          uint8_t  USB_ResponseLen[DAP_PACKET_COUNT];                // Response Length
+
+#if (USBD_BULK_ENABLE)
+#if (USBD_BULK_WMAXPACKETSIZE != DAP_PACKET_SIZE)
+	#error "USB Bulk Maximum Packet Size must match DAP Packet Size"
+#endif
+// Requests and responses of HID and bulk interface share the packet buffers,
+// a response is sent on the interface its request was received from.
+static          uint8_t  USB_RequestBulk [DAP_PACKET_COUNT];	// Request  received from bulk interface
+static          uint8_t  USB_ResponseBulk[DAP_PACKET_COUNT];	// Response to be sent to bulk interface
+static          uint8_t  USB_EventBulk;						// Last request received from bulk interface
+#endif
 //!!! static          uint8_t  HID_Flash_Buffer[DAP_PACKET_SIZE];
 
 // USB HID Callback: when system initializes
 void usbd_hid_init (void)
 {
-	USB_RequestFlag   = 0;
-	USB_RequestIn     = 0;
-	USB_RequestOut    = 0;
+	Ring_Init(&USB_RequestRing);
+	Ring_Init(&USB_ResponseRing);
 	USB_ResponseIdle  = 1;
-	USB_ResponseFlag  = 0;
-	USB_ResponseIn    = 0;
-	USB_ResponseOut   = 0;
+	USB_RequestPending = 0;
 }
 
-// USB HID Callback: when data needs to be prepared for the host
-int usbd_hid_get_report (U8 rtype, U8 rid, U8 *buf, U8 req)
+// Send next response to host on the interface its request was received from
+//	return:	none
+static void USB_ResponseSend (void)
 {
-	switch (rtype)
+	uint32_t slot;
+	uint8_t *data;
+	uint8_t  len;
+#if (USBD_BULK_ENABLE)
+	uint8_t  bulk;
+#endif
+
+	if (Ring_Count(&USB_ResponseRing) == 0)
 	{
-	case HID_REPORT_INPUT:
-		switch (req)
-		{
-		case USBD_HID_REQ_EP_CTRL:
-		case USBD_HID_REQ_PERIOD_UPDATE:
-			break;
-		case USBD_HID_REQ_EP_INT:
-			if ((USB_ResponseOut != USB_ResponseIn) || USB_ResponseFlag)
-			{
-				memcpy(buf, USB_Response[USB_ResponseOut], DAP_PACKET_SIZE);
-				USB_ResponseOut++;
-				if (USB_ResponseOut == DAP_PACKET_COUNT)
-					USB_ResponseOut = 0;
-				if (USB_ResponseOut == USB_ResponseIn)
-					USB_ResponseFlag = 0;
-				return (DAP_PACKET_SIZE);
-			}
-			else
-				USB_ResponseIdle = 1;
-			break;
-		}
-		break;
-	case HID_REPORT_FEATURE:
-		break;
+		USB_ResponseIdle = 1;
+		return;
 	}
-	return (0);
+
+	slot = RESPONSE_SLOT(USB_ResponseRing.out);
+	data = USB_Response[slot];
+	len  = USB_ResponseLen[slot];
+#if (USBD_BULK_ENABLE)
+	bulk = USB_ResponseBulk[slot];
+#endif
+	// Released before the endpoint write, so a completion interrupt does not
+	// send it twice. The producer (main loop) cannot reuse it meanwhile: it is
+	// either interrupted or it is the caller.
+	Ring_Get(&USB_ResponseRing, 1);
+
+	// Response buffer is copied into packet memory
+#if (USBD_BULK_ENABLE)
+	if (bulk)
+	{	// Send response with its actual length
+		USBD_WriteEP(USB_ENDPOINT_IN(USBD_BULK_EP_BULKIN), data, len);
+		return;
+	}
+#endif
+	// HID report has fixed size: pad response with zeros
+	memset(data + len, 0, DAP_PACKET_SIZE - len);
+	USBD_WriteEP(USB_ENDPOINT_IN(USBD_HID_EP_INTIN), data, DAP_PACKET_SIZE);
 }
 
-// USB HID Callback: when data is received from the host
-void usbd_hid_set_report (U8 rtype, U8 rid, U8 *buf, int len, U8 req)
+// Store request into request buffer
+//	buf:	request data (copied unless read directly into request buffer)
+//	len:	request length
+//	bulk:	1 = received from bulk interface, 0 = HID report
+static void USB_RequestStore (U8 *buf, int len, uint8_t bulk)
 {
-	switch (rtype)
+	uint32_t slot;
+
+	if (len == 0)
+		return;
+	if (buf[0] == ID_DAP_TransferAbort)
 	{
-	case HID_REPORT_OUTPUT:
-		if (len == 0)
-			break;
-		if (buf[0] == ID_DAP_TransferAbort)
+		if (pUserAppDescriptor != NULL)
+			pUserAppDescriptor->UserAbort();
+		return;
+	}
+	if (Ring_Free(&USB_RequestRing, DAP_PACKET_COUNT) == 0)
+		return;  // Discard packet when buffer is full (control endpoint)
+
+	// Store data into request packet buffer
+	slot = REQUEST_SLOT(USB_RequestRing.in);
+	if (buf != USB_Request[slot])
+		memcpy(USB_Request[slot], buf, len);
+#if (USBD_BULK_ENABLE)
+	USB_RequestBulk[slot] = bulk;
+#endif
+	Ring_Put(&USB_RequestRing, 1);
+}
+
+// Read packet from OUT endpoint directly into request buffer
+//   When the request buffer is full the packet is left in the endpoint
+//   buffer, the endpoint NAKs until usbd_hid_process frees a request.
+//   A transfer abort left in the endpoint is processed at once (the running
+//   transfer is what keeps the request buffer full) and discarded when read.
+//	ep:		OUT endpoint number
+//	bulk:	1 = bulk interface, 0 = HID interface
+static void USB_RequestRead (U32 ep, uint8_t bulk)
+{
+	uint8_t aborted;
+	U8 *buf;
+	int len;
+
+	aborted = bulk ? USB_ABORTED_BULK : USB_ABORTED_HID;
+	if (Ring_Free(&USB_RequestRing, DAP_PACKET_COUNT) == 0)
+	{
+		USB_RequestPending |= bulk ? USB_PENDING_BULK : USB_PENDING_HID;
+		if (((USB_RequestPending & aborted) == 0) &&
+			(USBD_PeekEP(ep) == ID_DAP_TransferAbort))
 		{
+			USB_RequestPending |= aborted;
 			if (pUserAppDescriptor != NULL)
 				pUserAppDescriptor->UserAbort();
-			break;
 		}
-		if (USB_RequestFlag && (USB_RequestIn == USB_RequestOut))
-			break;  // Discard packet when buffer is full
+		return;
+	}
+	buf = USB_Request[REQUEST_SLOT(USB_RequestRing.in)];
+	len = USBD_ReadEP(ep, buf);
+	if (USB_RequestPending & aborted)
+	{
+		USB_RequestPending &= ~aborted;
+		if ((len != 0) && (buf[0] == ID_DAP_TransferAbort))
+			return;
+	}
+	USB_RequestStore(buf, len, bulk);
+}
 
-		// Store data into request packet buffer
-		memcpy(USB_Request[USB_RequestIn], buf, len);
+// Read packets left in NAKing OUT endpoints after a request was freed
+//	return:	none
+static void USB_RequestResume (void)
+{
+	NVIC_DisableIRQ(USB_LP_CAN1_RX0_IRQn);
+	if (USB_RequestPending & USB_PENDING_HID)
+	{
+		USB_RequestPending &= ~USB_PENDING_HID;
+		USB_RequestRead(USBD_HID_EP_INTOUT, 0);
+	}
+#if (USBD_BULK_ENABLE)
+	if (USB_RequestPending & USB_PENDING_BULK)
+	{
+		USB_RequestPending &= ~USB_PENDING_BULK;
+		USB_RequestRead(USBD_BULK_EP_BULKOUT, 1);
+	}
+#endif
+	NVIC_EnableIRQ(USB_LP_CAN1_RX0_IRQn);
+}
 
-		USB_RequestIn++;
-		if (USB_RequestIn == DAP_PACKET_COUNT)
-			USB_RequestIn = 0;
-		if (USB_RequestIn == USB_RequestOut)
-			USB_RequestFlag = 1;
+// USB HID Callback: when data needs to be prepared for the host
+//	Input reports are sent from the response buffer by USBD_HID_EP_Direct_Event
+int usbd_hid_get_report (U8 rtype, U8 rid, U8 *buf, U8 req)
+{
+	return (0);
+}
+
+// USB HID Callback: when data is received from the host (control endpoint)
+void usbd_hid_set_report (U8 rtype, U8 rid, U8 *buf, int len, U8 req)
+{
+	switch (rtype)
+	{
+	case HID_REPORT_OUTPUT:
+		USB_RequestStore(buf, len, 0);
 		break;
 	case HID_REPORT_FEATURE:
 		break;
 	}
 }
 
+// USB Configure Event: endpoints were reset, no packet is left in them
+void USBD_HID_EP_Direct_Configure (void)
+{
+	USB_RequestPending = 0;
+}
+
+// USB HID Interrupt Endpoint Event: report received from host or sent
+//	event:	USBD_EVT_OUT, USBD_EVT_IN
+void USBD_HID_EP_Direct_Event (U32 event)
+{
+	if (event & USBD_EVT_OUT)
+	{
+		USB_RequestRead(USBD_HID_EP_INTOUT, 0);
+	}
+	if (event & USBD_EVT_IN)
+	{
+		USB_ResponseSend();
+	}
+}
+
+#if (USBD_BULK_ENABLE)
+// USB Bulk Endpoint Event: request received from host or response sent
+//	event:	USBD_EVT_OUT, USBD_EVT_IN
+void USBD_BULK_EP_BULK_Event (U32 event)
+{
+	if (event & USBD_EVT_OUT)
+	{
+		USB_RequestRead(USBD_BULK_EP_BULKOUT, 1);
+	}
+	if (event & USBD_EVT_IN)
+	{
+		USB_ResponseSend();
+	}
+}
+#endif
+
 #define PACK_DATA_PLONG(offs)	(uint32_t *)(*(uint32_t *)(request + offs))
 #define PACK_DATA_PBYTE(offs)	(uint8_t *) (*(uint32_t *)(request + offs))
 #define PACK_DATA_LONG(offs)	*(uint32_t *)(request + offs)
@@ -121,8 +267,14 @@ void usbd_hid_set_report (U8 rtype, U8 rid, U8 *buf, int len, U8 req)
 #define HID_Command6	0xD6
 #define HID_Command7	0xD7
 
-void HID_ProcessCommand(uint8_t *request, uint8_t *response)
+// Process HID flash command or DAP command
+//	request:	pointer to request data
+//	response:	pointer to response data
+//	return:		number of bytes in response
+uint32_t HID_ProcessCommand(uint8_t *request, uint8_t *response)
 {
+	uint8_t *start   = response;
+	uint32_t num;
 	uint8_t result   = 0xFF; //! DAP_OK;
 	uint16_t data;
 	uint16_t length;
@@ -223,59 +375,95 @@ void HID_ProcessCommand(uint8_t *request, uint8_t *response)
 			--response;
 			result = ID_DAP_Invalid;
 		}
-		*response = result;
+		*response++ = result;
+		num = response - start;
 	}
 	else
 	{
 		if (pUserAppDescriptor != NULL)
 		{
-			pUserAppDescriptor->UserProcess(USB_Request[USB_RequestOut], USB_Response[USB_ResponseIn]);
+			num = pUserAppDescriptor->UserProcess(request, response);
 		}
 		else
 		{
 			DEBUG("REQ:%02X no app\n", *request);
 			*response = ID_DAP_Invalid;
+			num = 1;
 		}
 	}
 
-	DEBUG("RES:%2X\n", *response);
+	DEBUG("RES:%2X\n", *start);
+	if ((num == 0) || (num > DAP_PACKET_SIZE))
+		num = DAP_PACKET_SIZE;
+	return (num);
 }
 
 // Process USB HID Data
 uint8_t usbd_hid_process (void)
 {
-	uint32_t n;
+	uint32_t req, res;
 
-	// Process pending requests
-	if ((USB_RequestOut != USB_RequestIn) || USB_RequestFlag)
+	// Process pending requests while a response buffer is free
+	if (Ring_Count(&USB_RequestRing) && Ring_Free(&USB_ResponseRing, DAP_PACKET_COUNT))
 	{
-		HID_ProcessCommand(USB_Request[USB_RequestOut], USB_Response[USB_ResponseIn]);
-
-		// Update request index and flag
-		n = USB_RequestOut + 1;
-		if (n == DAP_PACKET_COUNT)
-			n = 0;
-		USB_RequestOut = n;
-
-		if (USB_RequestOut == USB_RequestIn)
-			USB_RequestFlag = 0;
+		req = REQUEST_SLOT (USB_RequestRing.out);
+		res = RESPONSE_SLOT(USB_ResponseRing.in);
+		USB_ResponseLen [res] = HID_ProcessCommand(USB_Request[req], USB_Response[res]);
+#if (USBD_BULK_ENABLE)
+		USB_ResponseBulk[res] = USB_RequestBulk[req];
+		USB_EventBulk = USB_RequestBulk[req];
+#endif
+		Ring_Get(&USB_RequestRing, 1);
+		Ring_Put(&USB_ResponseRing, 1);
+		if (USB_RequestPending)
+			USB_RequestResume();
 
 		if (USB_ResponseIdle)
 		{	// Request that data is send back to host
 			USB_ResponseIdle = 0;
-			usbd_hid_get_report_trigger(0, USB_Response[USB_ResponseIn], DAP_PACKET_SIZE);
-		}
-		else
-		{	// Update response index and flag
-			n = USB_ResponseIn + 1;
-			if (n == DAP_PACKET_COUNT)
-				n = 0;
-			USB_ResponseIn = n;
-
-			if (USB_ResponseIn == USB_ResponseOut)
-				USB_ResponseFlag = 1;
+			USB_ResponseSend();
 		}
 		return 1;
 	}
 	return 0;
 }
+
+// Check for USB request waiting to be processed
+//   User application stops idle work (profiler burst, monitors) when set.
+//   return: 1 = request pending
+uint32_t usbd_hid_pending (void)
+{
+	return (Ring_Count(&USB_RequestRing) != 0);
+}
+
+// Process USB HID idle time
+//   User application can send an unsolicited report when no request is
+//   pending and all responses were sent to the host. The report is sent on
+//   the interface of the last request, the host reads only that endpoint.
+void usbd_hid_idle (void)
+{
+	uint8_t *data;
+	uint32_t len;
+
+	if ((pUserAppDescriptor == NULL) || (pUserAppDescriptor->UserIdle == NULL))
+		return;
+	if (Ring_Count(&USB_RequestRing) || !USB_ResponseIdle)
+		return;
+
+	data = USB_Response[RESPONSE_SLOT(USB_ResponseRing.in)];
+	len  = pUserAppDescriptor->UserIdle(data);
+	if ((len == 0) || (len > DAP_PACKET_SIZE))
+		return;
+
+	// Request that report is send to host
+	USB_ResponseIdle = 0;
+#if (USBD_BULK_ENABLE)
+	if (USB_EventBulk)
+	{
+		USBD_WriteEP(USB_ENDPOINT_IN(USBD_BULK_EP_BULKIN), data, len);
+		return;
+	}
+#endif
+	memset(data + len, 0, DAP_PACKET_SIZE - len);
+	USBD_WriteEP(USB_ENDPOINT_IN(USBD_HID_EP_INTIN), data, DAP_PACKET_SIZE);
+}
@@ -51,6 +51,28 @@
 
 #define PIN_DELAY()		PIN_DELAY_SLOW(DAP_Data.clock_delay)
 
+// Unrolled data bits (used by specialized transfer functions)
+#define SW_WRITE_BITS4(val, n)				\
+		SW_WRITE_BIT((val) >> ((n) + 0));	\
+		SW_WRITE_BIT((val) >> ((n) + 1));	\
+		SW_WRITE_BIT((val) >> ((n) + 2));	\
+		SW_WRITE_BIT((val) >> ((n) + 3))
+
+#define SW_READ_BITS4(val, n)							\
+		SW_READ_BIT(bit); val |= (uint32_t)bit << ((n) + 0);	\
+		SW_READ_BIT(bit); val |= (uint32_t)bit << ((n) + 1);	\
+		SW_READ_BIT(bit); val |= (uint32_t)bit << ((n) + 2);	\
+		SW_READ_BIT(bit); val |= (uint32_t)bit << ((n) + 3)
+
+// Parity of 32-bit value (nibble lookup in 0x6996)
+static __forceinline uint32_t SW_PARITY(uint32_t val)
+{
+	val ^= val >> 16;
+	val ^= val >> 8;
+	val ^= val >> 4;
+	return ((0x6996 >> (val & 0x0F)) & 1);
+}
+
 // Generate SWJ Sequence
 //	count:  sequence bit count
 //	data:	pointer to sequence bit data
@@ -88,6 +110,44 @@ void SWJ_Sequence (uint32_t count, uint8_t *data)
 #endif
 
 
+#if (DAP_SWJ_CLOCK_CAL != 0)
+
+// Measure SWJ clock period (used for clock calibration)
+//	return: CPU cycles for SWJ_CLOCK_CAL_CYCLES clock periods
+#define SWJ_ClockMeasureFunction(speed)	/**/			\
+SWJ_RAMFUNC uint32_t SWJ_ClockMeasure##speed (void)		\
+{														\
+	uint32_t ticks;										\
+	uint32_t n;											\
+														\
+	SysTick->LOAD = 0x00FFFFFF;							\
+	SysTick->VAL  = 0;									\
+	SysTick->CTRL = SysTick_CTRL_ENABLE_Msk | SysTick_CTRL_CLKSOURCE_Msk;	\
+	ticks = SysTick->VAL;								\
+	for (n = SWJ_CLOCK_CAL_CYCLES; n != 0; n--)			\
+	{													\
+		SW_CLOCK_CYCLE();								\
+	}													\
+	ticks = (ticks - SysTick->VAL) & 0x00FFFFFF;		\
+	SysTick->CTRL = 0;									\
+	return (ticks);										\
+}
+
+#undef  PIN_DELAY
+#undef  SWJ_RAMFUNC
+#define PIN_DELAY()		PIN_DELAY_FAST()
+#define SWJ_RAMFUNC		RAMFUNC
+SWJ_ClockMeasureFunction(Fast);
+
+#undef  PIN_DELAY
+#undef  SWJ_RAMFUNC
+#define PIN_DELAY()		PIN_DELAY_SLOW(DAP_Data.clock_delay)
+#define SWJ_RAMFUNC
+SWJ_ClockMeasureFunction(Slow);
+
+#endif
+
+
 #if (DAP_SWD != 0)
 
 // SWD Transfer I/O
@@ -95,7 +155,7 @@ void SWJ_Sequence (uint32_t count, uint8_t *data)
 //	data:	DATA[31:0]
 //	return:  ACK[2:0]
 #define SWD_TransferFunction(speed)	/**/						\
-uint8_t SWD_Transfer##speed (uint8_t request, uint32_t *data)	\
+SWJ_RAMFUNC uint8_t SWD_Transfer##speed (uint8_t request, uint32_t *data)	\
 {																\
 	uint8_t ack;												\
 	uint8_t bit;												\
@@ -240,29 +300,165 @@ uint8_t SWD_Transfer##speed (uint8_t request, uint32_t *data)	\
 		SW_CLOCK_CYCLE();	/* Back off data phase */							\
 	}																			\
 																				\
+	PIN_SWDIO_OUT_ENABLE();														\
 	PIN_SWDIO_OUT(1);															\
 	return (ack);																\
 }
 
 
+// SWD Transfer I/O specialized for the default configuration:
+//	turnaround = 1, idle_cycles = 0, data_phase = 0
+//	request: A[3:2] RnW APnDP
+//	data:	DATA[31:0]
+//	return:  ACK[2:0]
+#define SWD_TransferFunctionT1(speed)	/**/					\
+SWJ_RAMFUNC uint8_t SWD_Transfer##speed##T1 (uint8_t request, uint32_t *data)	\
+{																\
+	uint8_t ack;												\
+	uint8_t bit;												\
+	uint32_t val;												\
+	uint8_t n;													\
+																\
+	/* Packet Request: Start, APnDP, RnW, A2, A3, Parity, Stop, Park */	\
+	val = 0x81												\
+		| ((request & 0x0F) << 1)								\
+		| (((0x6996 >> (request & 0x0F)) & 1) << 5);			\
+	SW_WRITE_BITS4(val, 0);										\
+	SW_WRITE_BITS4(val, 4);										\
+																\
+	/* Turnaround */											\
+	PIN_SWDIO_OUT_DISABLE();									\
+	SW_CLOCK_CYCLE();											\
+																\
+	/* Acknowledge response */									\
+	SW_READ_BIT(bit);											\
+	ack  = bit << 0;											\
+	SW_READ_BIT(bit);											\
+	ack |= bit << 1;											\
+	SW_READ_BIT(bit);											\
+	ack |= bit << 2;											\
+																\
+	if (ack == DAP_TRANSFER_OK)									\
+	{	/* OK response */										\
+		if (request & DAP_TRANSFER_RnW)							\
+		{	/* Read RDATA[0:31] */								\
+			val = 0;											\
+			SW_READ_BITS4(val,  0);								\
+			SW_READ_BITS4(val,  4);								\
+			SW_READ_BITS4(val,  8);								\
+			SW_READ_BITS4(val, 12);								\
+			SW_READ_BITS4(val, 16);								\
+			SW_READ_BITS4(val, 20);								\
+			SW_READ_BITS4(val, 24);								\
+			SW_READ_BITS4(val, 28);								\
+			SW_READ_BIT(bit);		/* Read Parity */			\
+			if (SW_PARITY(val) != bit)							\
+			{													\
+				ack = DAP_TRANSFER_ERROR;						\
+			}													\
+			if (data) *data = val;								\
+			SW_CLOCK_CYCLE();		/* Turnaround */			\
+			PIN_SWDIO_OUT_ENABLE();								\
+		}														\
+		else													\
+		{														\
+			SW_CLOCK_CYCLE();		/* Turnaround */			\
+			PIN_SWDIO_OUT_ENABLE();								\
+			/* Write WDATA[0:31] + Parity */					\
+			val = *data;										\
+			SW_WRITE_BITS4(val,  0);							\
+			SW_WRITE_BITS4(val,  4);							\
+			SW_WRITE_BITS4(val,  8);							\
+			SW_WRITE_BITS4(val, 12);							\
+			SW_WRITE_BITS4(val, 16);							\
+			SW_WRITE_BITS4(val, 20);							\
+			SW_WRITE_BITS4(val, 24);							\
+			SW_WRITE_BITS4(val, 28);							\
+			SW_WRITE_BIT(SW_PARITY(val));						\
+		}														\
+		PIN_SWDIO_OUT(1);										\
+		return (ack);											\
+	}															\
+																\
+	if (ack == DAP_TRANSFER_WAIT || ack == DAP_TRANSFER_FAULT)	\
+	{	/* WAIT or FAULT response */							\
+		SW_CLOCK_CYCLE();			/* Turnaround */			\
+		PIN_SWDIO_OUT_ENABLE();									\
+		PIN_SWDIO_OUT(1);										\
+		return (ack);											\
+	}															\
+																\
+	/* Protocol error */										\
+	for (n = 1 + 32 + 1; n != 0; n--)							\
+	{															\
+		SW_CLOCK_CYCLE();	/* Back off data phase */			\
+	}															\
+																\
+	PIN_SWDIO_OUT_ENABLE();										\
+	PIN_SWDIO_OUT(1);											\
+	return (ack);												\
+}
+
+
 #undef  PIN_DELAY
+#undef  SWJ_RAMFUNC
 #define PIN_DELAY()		PIN_DELAY_FAST()
+#define SWJ_RAMFUNC		RAMFUNC
 SWD_TransferFunction(Fast);
+#undef  SWJ_RAMFUNC
+#define SWJ_RAMFUNC
+SWD_TransferFunctionT1(Fast);
 
 #undef  PIN_DELAY
+#undef  SWJ_RAMFUNC
 #define PIN_DELAY()		PIN_DELAY_SLOW(DAP_Data.clock_delay)
+#define SWJ_RAMFUNC
 SWD_TransferFunction(Slow);
+SWD_TransferFunctionT1(Slow);
 
-// SWD Transfer I/O
-//	request: A[3:2] RnW APnDP
-//	data:	DATA[31:0]
-//	return:  ACK[2:0]
-uint8_t  SWD_Transfer(uint8_t request, uint32_t *data)
+// Select SWD Transfer function for the current clock and SWD/Transfer configuration
+//	(called when DAP_SWJ_Clock, DAP_SWD_Configure or DAP_TransferConfigure change it)
+//	return: none
+void SWD_Select(void)
 {
-	if (DAP_Data.fast_clock)
-		return SWD_TransferFast(request, data);
+#if (DAP_SWJ_DMA != 0)
+	if (DAP_Data.dma_clock)
+	{
+		DAP_Data.swd_transfer = SWD_TransferDMA;
+	}
+	else
+#endif
+	if ((DAP_Data.swd_conf.turnaround   == 1) &&
+		(DAP_Data.swd_conf.data_phase   == 0) &&
+		(DAP_Data.transfer.idle_cycles  == 0))
+	{
+		if (DAP_Data.fast_clock)
+			DAP_Data.swd_transfer = SWD_TransferFastT1;
+		else
+			DAP_Data.swd_transfer = SWD_TransferSlowT1;
+	}
 	else
-		return SWD_TransferSlow(request, data);
+	{
+		if (DAP_Data.fast_clock)
+			DAP_Data.swd_transfer = SWD_TransferFast;
+		else
+			DAP_Data.swd_transfer = SWD_TransferSlow;
+	}
+
+#if (DAP_SWD_AUTO_CLOCK != 0)
+	DAP_Data.auto_clock.transfer = DAP_Data.swd_transfer;
+	if (DAP_Data.auto_clock.enable)
+	{
+		DAP_Data.swd_transfer = SWD_TransferAuto;
+	}
+#endif
+#if (DAP_SWD_RECOVERY != 0)
+	DAP_Data.recovery.transfer = DAP_Data.swd_transfer;
+	if (DAP_Data.recovery.enable)
+	{
+		DAP_Data.swd_transfer = SWD_TransferRecover;
+	}
+#endif
 }
 
 
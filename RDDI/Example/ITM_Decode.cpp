@@ -0,0 +1,256 @@
+/*
+ * ITM_Decode.cpp: ITM/DWT trace packet decoder
+ *
+ * Copyright (c) 2012, ARM Limited. All Rights Reserved.
+ */
+
+#include "stdafx.h"
+
+#include "ITM_Decode.h"
+
+
+// Parser states
+#define ITM_STATE_SYNC      0           // Wait for synchronization packet
+#define ITM_STATE_HEADER    1           // Wait for packet header
+#define ITM_STATE_SOURCE    2           // Source packet payload
+#define ITM_STATE_CONT      3           // Continuation bytes (timestamps, extension)
+
+// Packet headers
+#define ITM_SYNC_ZEROS      5           // Zero bytes before 0x80 (47 zero bits and one 1 bit)
+#define ITM_SYNC_END        0x80
+#define ITM_OVERFLOW        0x70
+#define ITM_GTS1            0x94        // Global timestamp bits [25:0]
+#define ITM_GTS2            0xB4        // Global timestamp bits [63:26]
+
+#define ITM_CONT_MAX        6           // Maximum number of continuation bytes
+
+
+// Deliver source packet to its sink
+//   dec    : Decoder
+//   header : Packet header
+//   value  : Payload
+static void ITM_Source (ITM_DECODER *dec, BYTE header, DWORD value) {
+  int size, port;
+
+  dec->packets++;
+  size = (header & 3) == 3 ? 4 : (header & 3);
+  if (header & 0x04) {                  // Hardware source
+    if (dec->hw) {
+      dec->hw(dec->hw_ctx, header >> 3, value, size, dec->time);
+      return;
+    }
+  } else {                              // Instrumentation (stimulus port)
+    port = (dec->page << 5) | (header >> 3);
+    if ((port < ITM_PORTS) && dec->port[port].func) {
+      dec->port[port].func(dec->port[port].ctx, port, value, size, dec->time);
+      return;
+    }
+  }
+  dec->dropped++;
+}
+
+
+// Report decoder event
+static void ITM_Event (ITM_DECODER *dec, int event, DWORD value, U64 time) {
+  if (dec->event) dec->event(dec->event_ctx, event, value, time);
+}
+
+
+// Complete packet with continuation bytes (timestamps, extension)
+//   dec    : Decoder (header, count and value of packet)
+static void ITM_Cont (ITM_DECODER *dec) {
+  U64   mask;
+  DWORD flags;
+
+  dec->packets++;
+  switch (dec->header) {
+    case ITM_GTS1:                      // Replace received low bits
+      if (dec->count >= 4) {
+        mask  = 0x03FFFFFF;
+        flags = (DWORD)(dec->value >> 26) & 3;  // ClkCh, Wrap
+      } else {
+        mask  = ((U64)1 << (7 * dec->count)) - 1;
+        flags = 0;
+      }
+      dec->gts = (dec->gts & ~mask) | (dec->value & mask);
+      ITM_Event(dec, ITM_EVENT_GLOBAL_TS, flags, dec->gts);
+      break;
+    case ITM_GTS2:
+      dec->gts = (dec->gts & 0x03FFFFFF) | (dec->value << 26);
+      ITM_Event(dec, ITM_EVENT_GLOBAL_TS, 0, dec->gts);
+      break;
+    default:
+      if ((dec->header & 0xCF) == 0xC0) {       // Local timestamp format 1
+        dec->time += dec->value;
+        ITM_Event(dec, ITM_EVENT_LOCAL_TS, (dec->header >> 4) & 3, dec->time);
+      } else if ((dec->header & 0x04) == 0) {   // Extension: stimulus port page
+        dec->page = (BYTE)(((dec->header >> 4) & 7) | (dec->value << 3));
+      }
+      break;
+  }
+}
+
+
+// Decode packet header
+//   dec    : Decoder
+//   b      : Header byte
+static void ITM_Header (ITM_DECODER *dec, BYTE b) {
+
+  if (b == 0) {                         // Part of synchronization packet
+    if (dec->zeros < ITM_SYNC_ZEROS) dec->zeros++;
+    return;
+  }
+  if ((b == ITM_SYNC_END) && (dec->zeros == ITM_SYNC_ZEROS)) {
+    dec->zeros = 0;
+    dec->state = ITM_STATE_HEADER;
+    dec->packets++;
+    ITM_Event(dec, ITM_EVENT_SYNC, 0, dec->time);
+    return;
+  }
+  dec->zeros = 0;
+  if (dec->state == ITM_STATE_SYNC) return;
+
+  if (b & 0x03) {                       // Source packet
+    dec->header = b;
+    dec->size   = (b & 3) == 3 ? 4 : (b & 3);
+    dec->count  = 0;
+    dec->value  = 0;
+    dec->state  = ITM_STATE_SOURCE;
+    return;
+  }
+
+  switch (b & 0x0F) {
+    case 0x00:
+      if (b == ITM_OVERFLOW) {
+        dec->packets++;
+        dec->overflows++;
+        ITM_Event(dec, ITM_EVENT_OVERFLOW, 0, dec->time);
+      } else if ((b & 0x80) == 0) {     // Local timestamp format 2
+        dec->packets++;
+        dec->time += (b >> 4) & 7;
+        ITM_Event(dec, ITM_EVENT_LOCAL_TS, ITM_TC_SYNC, dec->time);
+      } else if ((b & 0xC0) == 0xC0) {  // Local timestamp format 1
+        goto cont;
+      } else {
+        goto error;
+      }
+      return;
+    case 0x04:
+      if ((b == ITM_GTS1) || (b == ITM_GTS2)) goto cont;
+      goto error;
+    case 0x08:                          // Extension
+    case 0x0C:
+      if (b & 0x80) goto cont;
+      dec->header = b;
+      dec->count  = 0;
+      dec->value  = 0;
+      ITM_Cont(dec);
+      return;
+  }
+
+error:
+  dec->errors++;
+  ITM_Event(dec, ITM_EVENT_ERROR, b, dec->time);
+  return;
+
+cont:
+  dec->header = b;
+  dec->count  = 0;
+  dec->value  = 0;
+  dec->state  = ITM_STATE_CONT;
+}
+
+
+// Initialize decoder (all sinks removed)
+//   dec    : Decoder
+//   sync   : 1 - Wait for synchronization packet, 0 - Stream starts with packet header
+void ITM_Init (ITM_DECODER *dec, int sync) {
+  memset(dec, 0, sizeof(ITM_DECODER));
+  dec->state = sync ? ITM_STATE_SYNC : ITM_STATE_HEADER;
+}
+
+
+// Set stimulus port sink
+//   dec    : Decoder
+//   port   : Stimulus port number (0 .. ITM_PORTS-1)
+//   func   : Sink function (NULL - packets are dropped)
+//   ctx    : Sink context
+void ITM_SetPort (ITM_DECODER *dec, int port, ITM_PORT_SINK *func, void *ctx) {
+  if ((port < 0) || (port >= ITM_PORTS)) return;
+  dec->port[port].func = func;
+  dec->port[port].ctx  = ctx;
+}
+
+
+// Set hardware source (DWT) sink
+//   dec    : Decoder
+//   func   : Sink function (NULL - packets are dropped)
+//   ctx    : Sink context
+void ITM_SetHW (ITM_DECODER *dec, ITM_HW_SINK *func, void *ctx) {
+  dec->hw     = func;
+  dec->hw_ctx = ctx;
+}
+
+
+// Set event sink
+//   dec    : Decoder
+//   func   : Sink function (NULL - no events)
+//   ctx    : Sink context
+void ITM_SetEvent (ITM_DECODER *dec, ITM_EVENT_SINK *func, void *ctx) {
+  dec->event     = func;
+  dec->event_ctx = ctx;
+}
+
+
+// Decode trace data
+//   dec    : Decoder
+//   data   : Trace data
+//   len    : Number of bytes
+void ITM_Decode (ITM_DECODER *dec, const BYTE *data, int len) {
+  BYTE  b;
+  int   size;
+
+  while (len > 0) {
+    b = *data;
+
+    if (dec->state == ITM_STATE_HEADER) {
+      size = (b & 3) == 3 ? 4 : (b & 3);
+      if (size && (len > size)) {       // Fast path: complete source packet in buffer
+        switch (size) {
+          case 1: ITM_Source(dec, b, data[1]);                                  break;
+          case 2: ITM_Source(dec, b, data[1] | (data[2] << 8));                 break;
+          case 4: ITM_Source(dec, b, data[1] | (data[2] << 8) |
+                                     (data[3] << 16) | ((DWORD)data[4] << 24)); break;
+        }
+        dec->zeros = 0;
+        data += 1 + size;
+        len  -= 1 + size;
+        continue;
+      }
+    }
+    data++;
+    len--;
+
+    switch (dec->state) {
+      case ITM_STATE_SYNC:
+      case ITM_STATE_HEADER:
+        ITM_Header(dec, b);
+        break;
+      case ITM_STATE_SOURCE:
+        dec->value |= (U64)b << (8 * dec->count);
+        if (++dec->count == dec->size) {
+          ITM_Source(dec, dec->header, (DWORD)dec->value);
+          dec->state = ITM_STATE_HEADER;
+        }
+        break;
+      case ITM_STATE_CONT:
+        dec->value |= (U64)(b & 0x7F) << (7 * dec->count);
+        dec->count++;
+        if (((b & 0x80) == 0) || (dec->count == ITM_CONT_MAX)) {
+          ITM_Cont(dec);
+          dec->state = ITM_STATE_HEADER;
+        }
+        break;
+    }
+  }
+}
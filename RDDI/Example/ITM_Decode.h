@@ -0,0 +1,102 @@
+/*
+ * ITM_Decode.h:  ITM/DWT trace packet decoder definitions
+ *
+ * Decodes the SWO trace stream (read with DAP_SWO_Data) into ITM packets.
+ * Trace bytes are passed in chunks of any size; packets split between two
+ * chunks are completed with the next call. The decoder does not allocate
+ * memory and does not copy the trace data.
+ */
+
+#ifndef _ITM_DECODE_H_
+#define _ITM_DECODE_H_
+
+
+// Number of stimulus ports with sinks (port = page * 32 + address)
+#define ITM_PORTS               32
+
+// Hardware source (DWT) packet IDs
+#define ITM_HW_EVENT_COUNTER    0       // Event counter wrap (1 byte)
+#define ITM_HW_EXCEPTION        1       // Exception trace (2 bytes)
+#define ITM_HW_PC_SAMPLE        2       // Periodic PC sample (4 bytes, 1 byte if sleeping)
+#define ITM_HW_DATA_TRACE(id)   (((id) >= 8) && ((id) <= 23))
+#define ITM_HW_DATA_COMP(id)    (((id) >> 1) & 3)   // Comparator number
+#define ITM_HW_DATA_TYPE(id)    ((id) & 0x19)       // Data trace packet type:
+#define ITM_HW_DATA_PC          0x08                //   PC value
+#define ITM_HW_DATA_ADDR        0x09                //   Address offset
+#define ITM_HW_DATA_READ        0x10                //   Data value read
+#define ITM_HW_DATA_WRITE       0x11                //   Data value write
+
+// Decoder events
+#define ITM_EVENT_SYNC          0       // Synchronization packet
+#define ITM_EVENT_OVERFLOW      1       // Overflow packet (trace data was lost)
+#define ITM_EVENT_LOCAL_TS      2       // Local timestamp (value: TC[1:0])
+#define ITM_EVENT_GLOBAL_TS     3       // Global timestamp (value: bit0 = clock change, bit1 = wrap)
+#define ITM_EVENT_ERROR         4       // Reserved header or unknown packet (value: header)
+
+// Local timestamp TC values
+#define ITM_TC_SYNC             0       // Timestamp is synchronous to the packet
+#define ITM_TC_TS_DELAYED       1       // Timestamp delayed
+#define ITM_TC_PKT_DELAYED      2       // Packet delayed
+#define ITM_TC_BOTH_DELAYED     3       // Timestamp and packet delayed
+
+
+// Stimulus port sink
+//   ctx    : Sink context
+//   port   : Stimulus port number
+//   value  : Data (1, 2 or 4 bytes, little endian)
+//   size   : Data size in bytes
+//   time   : Local time (sum of local timestamps) of last timestamp packet
+typedef void (ITM_PORT_SINK)  (void *ctx, int port, DWORD value, int size, U64 time);
+
+// Hardware source sink
+//   ctx    : Sink context
+//   id     : Hardware source packet ID (ITM_HW_...)
+//   value  : Data (1, 2 or 4 bytes, little endian)
+//   size   : Data size in bytes
+//   time   : Local time of last timestamp packet
+typedef void (ITM_HW_SINK)    (void *ctx, int id, DWORD value, int size, U64 time);
+
+// Event sink
+//   ctx    : Sink context
+//   event  : Event (ITM_EVENT_...)
+//   value  : Event value
+//   time   : Local time, global timestamp for ITM_EVENT_GLOBAL_TS
+typedef void (ITM_EVENT_SINK) (void *ctx, int event, DWORD value, U64 time);
+
+// Decoder state
+typedef struct {
+  struct {
+    ITM_PORT_SINK  *func;
+    void           *ctx;
+  } port[ITM_PORTS];            // Stimulus port sinks
+  ITM_HW_SINK      *hw;         // Hardware source sink
+  void             *hw_ctx;
+  ITM_EVENT_SINK   *event;      // Event sink
+  void             *event_ctx;
+
+  BYTE   state;                 // Parser state
+  BYTE   header;                // Header of packet in progress
+  BYTE   count;                 // Payload bytes received
+  BYTE   size;                  // Payload size of source packet
+  BYTE   zeros;                 // Consecutive zero bytes (synchronization)
+  BYTE   page;                  // Stimulus port page (extension packet)
+  U64    value;                 // Payload value in progress
+  U64    time;                  // Local time (sum of local timestamps)
+  U64    gts;                   // Global timestamp
+
+  DWORD  packets;               // Number of decoded packets
+  DWORD  overflows;             // Number of overflow packets
+  DWORD  errors;                // Number of reserved headers and unknown packets
+  DWORD  dropped;               // Number of source packets without sink
+} ITM_DECODER;
+
+
+// Functions
+extern  void ITM_Init      (ITM_DECODER *dec, int sync);
+extern  void ITM_SetPort   (ITM_DECODER *dec, int port, ITM_PORT_SINK *func, void *ctx);
+extern  void ITM_SetHW     (ITM_DECODER *dec, ITM_HW_SINK *func, void *ctx);
+extern  void ITM_SetEvent  (ITM_DECODER *dec, ITM_EVENT_SINK *func, void *ctx);
+extern  void ITM_Decode    (ITM_DECODER *dec, const BYTE *data, int len);
+
+
+#endif  // _ITM_DECODE_H_
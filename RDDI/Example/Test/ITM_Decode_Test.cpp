@@ -0,0 +1,160 @@
+/*
+ * ITM_Decode_Test.cpp: Host test of the ITM/DWT trace packet decoder
+ *
+ * Decodes a sample SWO stream (every packet type of the ITM/DWT protocol)
+ * and compares the sink output with the expected output. The stream is
+ * decoded at once and in chunks of 1 .. 31 bytes, so every packet is also
+ * split between two calls of ITM_Decode.
+ *
+ * Build and run (in this directory):
+ *   g++ -Wall -Wextra -I. -I.. ITM_Decode_Test.cpp ../ITM_Decode.cpp -o ITM_Decode_Test
+ *   ./ITM_Decode_Test
+ */
+
+#include "stdafx.h"
+
+#include <stdio.h>
+#include <string>
+
+#include "ITM_Decode.h"
+
+
+// Sample SWO stream
+static const BYTE ITM_Sample[] = {
+  0x55, 0x03,                           // Data before synchronization (ignored)
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x80,   // Synchronization
+  0x01, 'H',                            // Port 0: "Hi\n"
+  0x01, 'i',
+  0x01, '\n',
+  0x0B, 0x78, 0x56, 0x34, 0x12,         // Port 1: 0x12345678
+  0x12, 0xCD, 0xAB,                     // Port 2: 0xABCD
+  0x30,                                 // Local timestamp format 2: +3
+  0xC0, 0x85, 0x01,                     // Local timestamp format 1: +133
+  0x01, 'A',                            // Port 0: 'A'
+  0xD0, 0x0A,                           // Local timestamp format 1, timestamp delayed: +10
+  0x29, 'x',                            // Port 5: no sink (dropped)
+  0x70,                                 // Overflow
+  0x94, 0x81, 0x82, 0x83, 0x24,         // Global timestamp 1 (clock change)
+  0xB4, 0x85, 0x00,                     // Global timestamp 2
+  0x94, 0x7F,                           // Global timestamp 1: low 7 bits
+  0x0E, 0x0F, 0x10,                     // Exception trace: exception 15 entered
+  0x17, 0x34, 0x12, 0x00, 0x08,         // PC sample: 0x08001234
+  0x15, 0x00,                           // PC sample: sleeping
+  0x8D, 0x42,                           // Data trace comparator 0: write 0x42
+  0x44,                                 // Reserved header (error)
+  0x18,                                 // Extension: stimulus port page 1
+  0x19, 0x41,                           // Port 35: outside of ITM_PORTS (dropped)
+  0x08,                                 // Extension: stimulus port page 0
+  0xF9, 'Z',                            // Port 31: 'Z'
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x80,   // Synchronization
+  0x0B, 0x00, 0x00, 0x00, 0x00,         // Port 1: 0 (zero payload)
+  0x01, 0x00,                           // Port 0: 0
+};
+
+// Expected sink output of the sample stream
+static const char ITM_Expected[] =
+  "EV 0 0 t=0\n"
+  "P0 1 00000048 t=0\n"
+  "P0 1 00000069 t=0\n"
+  "P0 1 0000000A t=0\n"
+  "P1 4 12345678 t=0\n"
+  "P2 2 0000ABCD t=0\n"
+  "EV 2 0 t=3\n"
+  "EV 2 0 t=136\n"
+  "P0 1 00000041 t=136\n"
+  "EV 2 1 t=146\n"
+  "EV 1 0 t=146\n"
+  "EV 3 1 t=0x000000000080C101\n"
+  "EV 3 0 t=0x000000001480C101\n"
+  "EV 3 0 t=0x000000001480C17F\n"
+  "HW 1 2 0000100F t=146\n"
+  "HW 2 4 08001234 t=146\n"
+  "HW 2 1 00000000 t=146\n"
+  "HW 17 1 00000042 t=146\n"
+  "EV 4 44 t=146\n"
+  "P31 1 0000005A t=146\n"
+  "EV 0 0 t=146\n"
+  "P1 4 00000000 t=146\n"
+  "P0 1 00000000 t=146\n"
+  "packets=26 overflows=1 errors=1 dropped=2\n";
+
+
+// Stimulus port sink
+static void Port_Sink (void *ctx, int port, DWORD value, int size, U64 time) {
+  char line[64];
+
+  snprintf(line, sizeof(line), "P%d %d %08X t=%llu\n", port, size, value, (unsigned long long)time);
+  *(std::string *)ctx += line;
+}
+
+// Hardware source sink
+static void HW_Sink (void *ctx, int id, DWORD value, int size, U64 time) {
+  char line[64];
+
+  snprintf(line, sizeof(line), "HW %d %d %08X t=%llu\n", id, size, value, (unsigned long long)time);
+  *(std::string *)ctx += line;
+}
+
+// Event sink
+static void Event_Sink (void *ctx, int event, DWORD value, U64 time) {
+  char line[64];
+
+  if (event == ITM_EVENT_GLOBAL_TS) {
+    snprintf(line, sizeof(line), "EV %d %X t=0x%016llX\n", event, value, (unsigned long long)time);
+  } else {
+    snprintf(line, sizeof(line), "EV %d %X t=%llu\n", event, value, (unsigned long long)time);
+  }
+  *(std::string *)ctx += line;
+}
+
+
+// Decode sample stream
+//   chunk  : Bytes per ITM_Decode call
+//   return : Sink output and decoder counters
+static std::string Decode (int chunk) {
+  ITM_DECODER  dec;
+  std::string  out;
+  char         line[96];
+  int          pos, n;
+
+  ITM_Init(&dec, 1);
+  ITM_SetPort(&dec, 0,  Port_Sink, &out);
+  ITM_SetPort(&dec, 1,  Port_Sink, &out);
+  ITM_SetPort(&dec, 2,  Port_Sink, &out);
+  ITM_SetPort(&dec, 31, Port_Sink, &out);
+  ITM_SetHW(&dec, HW_Sink, &out);
+  ITM_SetEvent(&dec, Event_Sink, &out);
+
+  for (pos = 0; pos < (int)sizeof(ITM_Sample); pos += n) {
+    n = (int)sizeof(ITM_Sample) - pos;
+    if (n > chunk) n = chunk;
+    ITM_Decode(&dec, &ITM_Sample[pos], n);
+  }
+
+  snprintf(line, sizeof(line), "packets=%u overflows=%u errors=%u dropped=%u\n",
+           dec.packets, dec.overflows, dec.errors, dec.dropped);
+  out += line;
+  return (out);
+}
+
+
+int main (void) {
+  std::string  out;
+  int          chunk;
+  int          failed = 0;
+
+  out = Decode(sizeof(ITM_Sample));
+  if (out != ITM_Expected) {
+    printf("FAIL: complete stream\n%s", out.c_str());
+    failed++;
+  }
+  for (chunk = 1; chunk <= 31; chunk++) {
+    out = Decode(chunk);
+    if (out != ITM_Expected) {
+      printf("FAIL: chunk size %d\n%s", chunk, out.c_str());
+      failed++;
+    }
+  }
+  printf("%s\n", failed ? "ITM_Decode: FAILED" : "ITM_Decode: OK");
+  return (failed ? 1 : 0);
+}
@@ -0,0 +1,17 @@
+/*
+ * stdafx.h: Host build of the ITM decoder test (g++)
+ *
+ * Replaces the precompiled header of the Visual Studio project with the
+ * types used by ITM_Decode.cpp.
+ */
+
+#ifndef _STDAFX_H_
+#define _STDAFX_H_
+
+#include <string.h>
+
+typedef unsigned char       BYTE;
+typedef unsigned int        DWORD;
+typedef unsigned long long  U64;
+
+#endif  // _STDAFX_H_